@@ -381,53 +381,251 @@ bool PN532::setRFField(uint8_t autoRFCA, uint8_t rFOnOff)
 /**************************************************************************/
 bool PN532::readPassiveTargetID(uint8_t cardbaudrate, uint8_t *uid, uint8_t *uidLength, uint16_t timeout)
 {
+    if (!startPassiveTargetIDDetection(cardbaudrate)) {
+        return 0x0;  // command failed
+    }
+
+    return readDetectedPassiveTargetID(uid, uidLength, timeout);
+}
+
+/**************************************************************************/
+/*!
+    Sends InListPassiveTarget and returns as soon as the PN532 acknowledges
+    it, without waiting for a target. Use isReady() to poll for a card and
+    readDetectedPassiveTargetID() or readDetectedPassiveTargets() to fetch it.
+
+    @param  cardBaudRate  Baud rate of the card
+    @param  maxTargets    Targets to initialize at once, 1 or PN532_MAX_TARGETS
+
+    @returns 1 if the command was acknowledged, 0 for an error
+*/
+/**************************************************************************/
+bool PN532::startPassiveTargetIDDetection(uint8_t cardbaudrate, uint8_t maxTargets)
+{
+    if (maxTargets < 1) maxTargets = 1;
+    if (maxTargets > PN532_MAX_TARGETS) maxTargets = PN532_MAX_TARGETS;
+
     pn532_packetbuffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
-    pn532_packetbuffer[1] = 1;  // max 1 cards at once (we can set this to 2 later)
+    pn532_packetbuffer[1] = maxTargets;
     pn532_packetbuffer[2] = cardbaudrate;
 
-    if (HAL(writeCommand)(pn532_packetbuffer, 3)) {
-        return 0x0;  // command failed
+    return HAL(writeCommand)(pn532_packetbuffer, 3) == 0;
+}
+
+/**************************************************************************/
+/*!
+    Reads the response of startPassiveTargetIDDetection()
+
+    @param  uid           Pointer to the array that will be populated
+                          with the card's UID (up to 7 bytes)
+    @param  uidLength     Pointer to the variable that will hold the
+                          length of the card's UID.
+    @param  timeout       max time to wait, 0 means no timeout
+
+    @returns 1 if everything executed properly, 0 for an error
+*/
+/**************************************************************************/
+bool PN532::readDetectedPassiveTargetID(uint8_t *uid, uint8_t *uidLength, uint16_t timeout)
+{
+    PN532_TargetA target;
+    if (readDetectedPassiveTargets(&target, 1, timeout) != 1)
+        return 0;
+
+    /* Card appears to be Mifare Classic */
+    *uidLength = target.uidLength;
+
+    for (uint8_t i = 0; i < target.uidLength; i++) {
+        uid[i] = target.uid[i];
     }
 
+    return 1;
+}
+
+/**************************************************************************/
+/*!
+    Reads the ISO14443A targets found after startPassiveTargetIDDetection()
+
+    @param  targets       Array that will hold the targets
+    @param  maxTargets    Size of the array
+    @param  timeout       max time to wait, 0 means no timeout
+
+    @returns number of targets read, -1 for an error
+*/
+/**************************************************************************/
+int8_t PN532::readDetectedPassiveTargets(PN532_TargetA *targets, uint8_t maxTargets, uint16_t timeout)
+{
     // read data packet
-    if (HAL(readResponse)(pn532_packetbuffer, sizeof(pn532_packetbuffer), timeout) < 0) {
-        return 0x0;
+    int16_t length = HAL(readResponse)(pn532_packetbuffer, sizeof(pn532_packetbuffer), timeout);
+    if (length < 1) {
+        return -1;
     }
 
-    // check some basic stuff
     /* ISO14443A card response should be in the following format:
 
       byte            Description
       -------------   ------------------------------------------
       b0              Tags Found
-      b1              Tag Number (only one used in this example)
-      b2..3           SENS_RES
-      b4              SEL_RES
-      b5              NFCID Length
-      b6..NFCIDLen    NFCID
+      then for each target:
+      b0              Tag Number
+      b1..2           SENS_RES
+      b3              SEL_RES
+      b4              NFCID Length
+      b5..NFCIDLen    NFCID
+      ..              ATS (if SEL_RES & 0x20), first byte is its length
     */
 
-    if (pn532_packetbuffer[0] != 1)
-        return 0;
+    uint8_t found = pn532_packetbuffer[0];
+    if (found > maxTargets) {
+        return -1;
+    }
 
-    uint16_t sens_res = pn532_packetbuffer[2];
-    sens_res <<= 8;
-    sens_res |= pn532_packetbuffer[3];
+    uint8_t pos = 1;
+    for (uint8_t t = 0; t < found; t++) {
+        if (pos + 5 > length) {
+            return -1;
+        }
 
-    DMSG("ATQA: 0x");  DMSG_HEX(sens_res);
-    DMSG("SAK: 0x");  DMSG_HEX(pn532_packetbuffer[4]);
-    DMSG("\n");
+        PN532_TargetA &target = targets[t];
+        target.tg = pn532_packetbuffer[pos];
+        target.atqa = (uint16_t)pn532_packetbuffer[pos + 1] << 8 | pn532_packetbuffer[pos + 2];
+        target.sak = pn532_packetbuffer[pos + 3];
+        target.uidLength = pn532_packetbuffer[pos + 4];
+        pos += 5;
 
-    /* Card appears to be Mifare Classic */
-    *uidLength = pn532_packetbuffer[5];
+        if (target.uidLength > PN532_MAX_UID_LENGTH || pos + target.uidLength > length) {
+            return -1;
+        }
+        for (uint8_t i = 0; i < target.uidLength; i++) {
+            target.uid[i] = pn532_packetbuffer[pos + i];
+        }
+        pos += target.uidLength;
+
+        if (target.sak & 0x20) {
+            // ISO14443-4 card: skip the ATS
+            if (pos >= length || pn532_packetbuffer[pos] == 0) {
+                return -1;
+            }
+            pos += pn532_packetbuffer[pos];
+        }
 
-    for (uint8_t i = 0; i < pn532_packetbuffer[5]; i++) {
-        uid[i] = pn532_packetbuffer[6 + i];
+        DMSG("ATQA: 0x");  DMSG_HEX(target.atqa);
+        DMSG("SAK: 0x");  DMSG_HEX(target.sak);
+        DMSG("\n");
     }
 
-    return 1;
+    return found;
 }
 
+/**************************************************************************/
+/*!
+    Waits for up to maxTargets ISO14443A targets in a single poll
+
+    @param  cardBaudRate  Baud rate of the card
+    @param  targets       Array that will hold the targets
+    @param  maxTargets    Size of the array, 1 or PN532_MAX_TARGETS
+    @param  timeout       max time to wait, 0 means no timeout
+
+    @returns number of targets read, -1 for an error
+*/
+/**************************************************************************/
+int8_t PN532::readPassiveTargets(uint8_t cardbaudrate, PN532_TargetA *targets, uint8_t maxTargets, uint16_t timeout)
+{
+    if (!startPassiveTargetIDDetection(cardbaudrate, maxTargets)) {
+        return -1;  // command failed
+    }
+
+    return readDetectedPassiveTargets(targets, maxTargets, timeout);
+}
+
+/**************************************************************************/
+/*!
+    Checks without waiting whether the response of the last command
+    (e.g. a target found after startPassiveTargetIDDetection()) is available
+*/
+/**************************************************************************/
+bool PN532::isReady()
+{
+    return HAL(isReady)();
+}
+
+
+/**************************************************************************/
+/*!
+    Starts InAutoPoll: the PN532 polls the given target types on its own
+    and answers only when a target is found or the polls are over, so the
+    host is free meanwhile. Use isReady() to poll for the answer and
+    readAutoPollResult() to fetch it.
+
+    @param  types        Target types to poll (PN532_AUTOPOLL_*)
+    @param  typesLength  Number of types, 1 to PN532_AUTOPOLL_MAX_TYPES
+    @param  period       Time between polling cycles in units of 150 ms (1-15)
+    @param  count        Polling cycles, PN532_AUTOPOLL_ENDLESS to poll until a target is found
+
+    @returns 1 if the command was acknowledged, 0 for an error
+*/
+/**************************************************************************/
+bool PN532::startAutoPoll(const uint8_t *types, uint8_t typesLength, uint8_t period, uint8_t count)
+{
+    if (typesLength == 0 || typesLength > PN532_AUTOPOLL_MAX_TYPES || count == 0) {
+        return 0;
+    }
+    if (period < 1) period = 1;
+    if (period > 15) period = 15;
+
+    pn532_packetbuffer[0] = PN532_COMMAND_INAUTOPOLL;
+    pn532_packetbuffer[1] = count;
+    pn532_packetbuffer[2] = period;
+
+    return HAL(writeCommand)(pn532_packetbuffer, 3, types, typesLength) == 0;
+}
+
+/**************************************************************************/
+/*!
+    Reads the answer of startAutoPoll()
+
+    @param  type        Type of the first target found (PN532_AUTOPOLL_*)
+    @param  data        Target data, as in InListPassiveTarget; for type A:
+                        Tg, SENS_RES (2), SEL_RES, NFCID length, NFCID
+    @param  dataLength  In: size of data, out: length of the target data
+    @param  timeout     max time to wait, 0 means no timeout
+
+    @returns number of targets found, 0 if the polls ended without a target,
+             -1 for an error
+*/
+/**************************************************************************/
+int8_t PN532::readAutoPollResult(uint8_t *type, uint8_t *data, uint8_t *dataLength, uint16_t timeout)
+{
+    int16_t status = HAL(readResponse)(pn532_packetbuffer, sizeof(pn532_packetbuffer), timeout);
+    if (status < 1) {
+        return -1;
+    }
+
+    /* InAutoPoll response:
+
+      byte            Description
+      -------------   ------------------------------------------
+      b0              Targets found
+      b1              Type of the first target
+      b2              Length of its target data
+      b3..            Target data
+    */
+
+    uint8_t targets = pn532_packetbuffer[0];
+    if (targets == 0) {
+        return 0;
+    }
+
+    uint8_t length = pn532_packetbuffer[2];
+    if (status < 3 || 3 + length > status || length > *dataLength) {
+        return -1;
+    }
+
+    *type = pn532_packetbuffer[1];
+    memcpy(data, pn532_packetbuffer + 3, length);
+    *dataLength = length;
+
+    return targets;
+}
 
 /***** Mifare Classic Functions ******/
 
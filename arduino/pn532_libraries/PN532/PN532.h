@@ -109,6 +109,20 @@
 #define NDEF_URIPREFIX_URN_EPC              (0x22)
 #define NDEF_URIPREFIX_URN_NFC              (0x23)
 
+// InAutoPoll target types
+#define PN532_AUTOPOLL_GENERIC_106          (0x00)  // ISO14443-4A, Mifare and DEP at 106 kbps
+#define PN532_AUTOPOLL_GENERIC_212          (0x01)  // FeliCa and DEP at 212 kbps
+#define PN532_AUTOPOLL_GENERIC_424          (0x02)  // FeliCa and DEP at 424 kbps
+#define PN532_AUTOPOLL_ISO14443B_106        (0x03)
+#define PN532_AUTOPOLL_JEWEL                (0x04)
+#define PN532_AUTOPOLL_MIFARE               (0x10)
+#define PN532_AUTOPOLL_FELICA_212           (0x11)
+#define PN532_AUTOPOLL_FELICA_424           (0x12)
+#define PN532_AUTOPOLL_ISO14443_4A          (0x20)
+#define PN532_AUTOPOLL_ISO14443_4B          (0x23)
+#define PN532_AUTOPOLL_MAX_TYPES            (15)
+#define PN532_AUTOPOLL_ENDLESS              (0xFF)  // poll until a target is found
+
 #define PN532_GPIO_VALIDATIONBIT            (0x80)
 #define PN532_GPIO_P30                      (0)
 #define PN532_GPIO_P31                      (1)
@@ -124,6 +138,19 @@
 #define FELICA_WRITE_MAX_BLOCK_NUM          10 // for typical FeliCa card
 #define FELICA_REQ_SERVICE_MAX_NODE_NUM     32
 
+// ISO14443A consts
+#define PN532_MAX_TARGETS                   2   // InListPassiveTarget MaxTg limit
+#define PN532_MAX_UID_LENGTH                10  // triple size UID
+
+// ISO14443A target found by InListPassiveTarget
+struct PN532_TargetA {
+    uint8_t  tg;            // logical number assigned by the PN532
+    uint16_t atqa;          // SENS_RES
+    uint8_t  sak;           // SEL_RES
+    uint8_t  uidLength;
+    uint8_t  uid[PN532_MAX_UID_LENGTH];
+};
+
 class PN532
 {
 public:
@@ -159,6 +186,15 @@ public:
     // ISO14443A functions
     bool inListPassiveTarget();
     bool readPassiveTargetID(uint8_t cardbaudrate, uint8_t *uid, uint8_t *uidLength, uint16_t timeout = 1000);
+    bool startPassiveTargetIDDetection(uint8_t cardbaudrate, uint8_t maxTargets = 1);
+    int8_t readDetectedPassiveTargets(PN532_TargetA *targets, uint8_t maxTargets, uint16_t timeout = 1000);
+    int8_t readPassiveTargets(uint8_t cardbaudrate, PN532_TargetA *targets, uint8_t maxTargets, uint16_t timeout = 1000);
+    bool readDetectedPassiveTargetID(uint8_t *uid, uint8_t *uidLength, uint16_t timeout = 1000);
+    bool isReady();
+
+    // Autonomous polling
+    bool startAutoPoll(const uint8_t *types, uint8_t typesLength, uint8_t period, uint8_t count = PN532_AUTOPOLL_ENDLESS);
+    int8_t readAutoPollResult(uint8_t *type, uint8_t *data, uint8_t *dataLength, uint16_t timeout = 1000);
     bool inDataExchange(uint8_t *send, uint8_t sendLength, uint8_t *response, uint8_t *responseLength);
 
     // Mifare Classic functions
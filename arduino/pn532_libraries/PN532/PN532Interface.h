@@ -27,6 +27,8 @@
 class PN532Interface
 {
 public:
+    virtual ~PN532Interface() {}
+
     virtual void begin() = 0;
     virtual void wakeup() = 0;
 
@@ -50,6 +52,20 @@ public:
     *           <0      failed to read response
     */
     virtual int16_t readResponse(uint8_t buf[], uint8_t len, uint16_t timeout = 1000) = 0;
+
+    /**
+    * @brief    check without waiting whether the response of the last command is available
+    * @return   true    readResponse() will not wait for the PN532
+    *           false   the command is still running
+    */
+    virtual bool isReady() = 0;
+
+    /**
+    * @brief    bus statistics, for transports that keep them
+    */
+    virtual bool irqMode() const { return false; }
+    virtual uint32_t statusReads() const { return 0; }
+    virtual uint32_t irqEvents() const { return 0; }
 };
 
 #endif
@@ -0,0 +1,83 @@
+#include "PN532_irq.h"
+#include "Arduino.h"
+
+volatile uint8_t  PN532_IRQ::fired[PN532_IRQ_SLOTS];
+volatile uint32_t PN532_IRQ::counts[PN532_IRQ_SLOTS];
+bool              PN532_IRQ::used[PN532_IRQ_SLOTS];
+
+void (*const PN532_IRQ::handlers[PN532_IRQ_SLOTS])() = {
+    &PN532_IRQ::handler<0>, &PN532_IRQ::handler<1>, &PN532_IRQ::handler<2>, &PN532_IRQ::handler<3>
+};
+
+PN532_IRQ::PN532_IRQ()
+{
+    _pin  = PN532_NO_IRQ;
+    _slot = -1;
+}
+
+bool PN532_IRQ::attach(uint8_t pin)
+{
+    detach();
+    if (pin == PN532_NO_IRQ) {
+        return false;
+    }
+
+    int interrupt = digitalPinToInterrupt(pin);
+#ifdef NOT_AN_INTERRUPT
+    if (interrupt == NOT_AN_INTERRUPT) {
+        return false;
+    }
+#endif
+
+    int8_t slot = -1;
+    for (uint8_t i = 0; i < PN532_IRQ_SLOTS; i++) {
+        if (!used[i]) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return false;
+    }
+
+    pinMode(pin, INPUT_PULLUP);
+    used[slot]   = true;
+    fired[slot]  = 0;
+    counts[slot] = 0;
+    _pin  = pin;
+    _slot = slot;
+    attachInterrupt(interrupt, handlers[slot], FALLING);
+    return true;
+}
+
+void PN532_IRQ::detach()
+{
+    if (_slot < 0) {
+        return;
+    }
+    detachInterrupt(digitalPinToInterrupt(_pin));
+    used[_slot] = false;
+    _pin  = PN532_NO_IRQ;
+    _slot = -1;
+}
+
+bool PN532_IRQ::ready() const
+{
+    return fired[_slot] || digitalRead(_pin) == LOW;
+}
+
+void PN532_IRQ::clear()
+{
+    fired[_slot] = 0;
+}
+
+uint32_t PN532_IRQ::events() const
+{
+    if (_slot < 0) {
+        return 0;
+    }
+    noInterrupts();
+    uint32_t n = counts[_slot];
+    interrupts();
+    return n;
+}
@@ -0,0 +1,64 @@
+#ifndef __PN532_IRQ_H__
+#define __PN532_IRQ_H__
+
+#include <stdint.h>
+
+#define PN532_NO_IRQ                  (0xFF)  // no IRQ pin: poll the status over the bus
+#define PN532_IRQ_SLOTS               (4)     // transports that can use an IRQ pin at the same time
+
+/**
+* @brief    IRQ line of the PN532, driven low while a frame (ACK or response) is ready
+*
+* A FALLING interrupt sets a flag, so readiness is known without any bus
+* transfer. When the pin has no interrupt or all slots are taken, attach()
+* fails and the transport keeps polling the status over SPI/I2C.
+*/
+class PN532_IRQ
+{
+public:
+    PN532_IRQ();
+
+    /**
+    * @brief    configure the pin and attach the interrupt
+    * @param    pin     IRQ pin, PN532_NO_IRQ for polling
+    * @return   true    interrupt attached
+    *           false   polling fallback
+    */
+    bool attach(uint8_t pin);
+    void detach();
+
+    bool attached() const { return _slot >= 0; }
+
+    /**
+    * @brief    true if a frame is ready; the pin level covers an edge lost before attach()
+    */
+    bool ready() const;
+
+    /**
+    * @brief    forget the last edge, call before reading a frame
+    */
+    void clear();
+
+    /**
+    * @brief    interrupts received since attach()
+    */
+    uint32_t events() const;
+
+private:
+    uint8_t _pin;
+    int8_t  _slot;
+
+    static volatile uint8_t  fired[PN532_IRQ_SLOTS];
+    static volatile uint32_t counts[PN532_IRQ_SLOTS];
+    static bool              used[PN532_IRQ_SLOTS];
+    static void (*const handlers[PN532_IRQ_SLOTS])();
+
+    template <uint8_t Slot>
+    static void handler()
+    {
+        fired[Slot] = 1;
+        counts[Slot]++;
+    }
+};
+
+#endif
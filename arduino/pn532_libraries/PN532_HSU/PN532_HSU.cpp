@@ -81,6 +81,11 @@ int8_t PN532_HSU::writeCommand(const uint8_t *header, uint8_t hlen, const uint8_
     return readAckFrame();
 }
 
+bool PN532_HSU::isReady()
+{
+    return _serial->available() > 0;
+}
+
 int16_t PN532_HSU::readResponse(uint8_t buf[], uint8_t len, uint16_t timeout)
 {
     uint8_t tmp[3];
@@ -9,15 +9,18 @@
 #define PN532_I2C_ADDRESS       (0x48 >> 1)
 
 
-PN532_I2C::PN532_I2C(TwoWire &wire)
+PN532_I2C::PN532_I2C(TwoWire &wire, uint8_t irq)
 {
     _wire = &wire;
     command = 0;
+    _irqPin = irq;
+    _statusReads = 0;
 }
 
 void PN532_I2C::begin()
 {
     _wire->begin();
+    _irq.attach(_irqPin);   // polling fallback if the pin has no interrupt
 }
 
 void PN532_I2C::wakeup()
@@ -76,11 +79,60 @@ int8_t PN532_I2C::writeCommand(const uint8_t *header, uint8_t hlen, const uint8_
     return readAckFrame();
 }
 
+bool PN532_I2C::isReady()
+{
+    const uint8_t PN532_NACK[] = {0, 0, 0xFF, 0xFF, 0, 0};
+
+    if (_irq.attached()) {
+        return _irq.ready();
+    }
+
+    _statusReads++;
+    if (!_wire->requestFrom(PN532_I2C_ADDRESS, 1) || !(read() & 1)) {
+        return false;
+    }
+
+    // the status read started the response, request it again for readResponse()
+    _wire->beginTransmission(PN532_I2C_ADDRESS);
+    for (uint16_t i = 0; i < sizeof(PN532_NACK); ++i) {
+      write(PN532_NACK[i]);
+    }
+    _wire->endTransmission();
+
+    return true;
+}
+
+/**
+* @brief    with the IRQ pin, wait for the PN532 to assert it without bus transfers
+* @param    timeout max time to wait in ms, 0 means no timeout
+* @return   false on timeout; always true in polling mode
+*/
+bool PN532_I2C::waitIrq(uint16_t timeout)
+{
+    if (!_irq.attached()) {
+        return true;
+    }
+
+    unsigned long start = millis();
+    while (!_irq.ready()) {
+        if (timeout > 0 && millis() - start > timeout) {
+            return false;
+        }
+    }
+    _irq.clear();
+    return true;
+}
+
 int16_t PN532_I2C::getResponseLength(uint8_t buf[], uint8_t len, uint16_t timeout) {
     const uint8_t PN532_NACK[] = {0, 0, 0xFF, 0xFF, 0, 0};
     uint16_t time = 0;
 
+    if (!waitIrq(timeout)) {
+        return -1;
+    }
+
     do {
+        _statusReads++;
         if (_wire->requestFrom(PN532_I2C_ADDRESS, 6)) {
             if (read() & 1) {  // check first byte --- status
                 break;         // PN532 is ready
@@ -115,6 +167,19 @@ int16_t PN532_I2C::getResponseLength(uint8_t buf[], uint8_t len, uint16_t timeou
 }
 
 int16_t PN532_I2C::readResponse(uint8_t buf[], uint8_t len, uint16_t timeout)
+{
+    int16_t result = readFrame(buf, len, timeout);
+
+    // the NACK resend asserted IRQ again and latched a new edge: the frame is
+    // consumed now, forget it so isReady() waits for the next response.
+    // A frame that follows at once is still seen through the pin level
+    if (_irq.attached()) {
+        _irq.clear();
+    }
+    return result;
+}
+
+int16_t PN532_I2C::readFrame(uint8_t buf[], uint8_t len, uint16_t timeout)
 {
     uint16_t time = 0;
     uint8_t length;
@@ -123,6 +188,7 @@ int16_t PN532_I2C::readResponse(uint8_t buf[], uint8_t len, uint16_t timeout)
 
     // [RDY] 00 00 FF LEN LCS (TFI PD0 ... PDn) DCS 00
     do {
+        _statusReads++;
         if (_wire->requestFrom(PN532_I2C_ADDRESS, 6 + length + 2)) {
             if (read() & 1) {  // check first byte --- status
                 break;         // PN532 is ready
@@ -192,7 +258,13 @@ int8_t PN532_I2C::readAckFrame()
     DMSG('\n');
     
     uint16_t time = 0;
+    if (!waitIrq(PN532_ACK_WAIT_TIME)) {
+        DMSG("Time out when waiting for ACK\n");
+        return PN532_TIMEOUT;
+    }
+
     do {
+        _statusReads++;
         if (_wire->requestFrom(PN532_I2C_ADDRESS,  sizeof(PN532_ACK) + 1)) {
             if (read() & 1) {  // check first byte --- status
                 break;         // PN532 is ready
@@ -215,6 +287,11 @@ int8_t PN532_I2C::readAckFrame()
     for (uint8_t i = 0; i < sizeof(PN532_ACK); i++) {
         ackBuf[i] = read();
     }
+
+    // the ACK edge may have latched after waitIrq() cleared the flag
+    if (_irq.attached()) {
+        _irq.clear();
+    }
     
     if (memcmp(ackBuf, PN532_ACK, sizeof(PN532_ACK))) {
         DMSG("Invalid ACK\n");
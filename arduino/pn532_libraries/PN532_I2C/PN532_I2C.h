@@ -7,22 +7,33 @@
 
 #include <Wire.h>
 #include "PN532Interface.h"
+#include "PN532_irq.h"
 
 class PN532_I2C : public PN532Interface {
 public:
-    PN532_I2C(TwoWire &wire);
+    PN532_I2C(TwoWire &wire, uint8_t irq = PN532_NO_IRQ);
     
     void begin();
     void wakeup();
     virtual int8_t writeCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body = 0, uint8_t blen = 0);
     int16_t readResponse(uint8_t buf[], uint8_t len, uint16_t timeout);
+    bool isReady();
+
+    bool irqMode() const { return _irq.attached(); }
+    uint32_t statusReads() const { return _statusReads; }
+    uint32_t irqEvents() const { return _irq.events(); }
     
 private:
     TwoWire* _wire;
     uint8_t command;
+    uint8_t _irqPin;
+    PN532_IRQ _irq;
+    uint32_t _statusReads;      // status reads on the bus
     
+    bool waitIrq(uint16_t timeout);
     int8_t readAckFrame();
     int16_t getResponseLength(uint8_t buf[], uint8_t len, uint16_t timeout);
+    int16_t readFrame(uint8_t buf[], uint8_t len, uint16_t timeout);
     
     inline uint8_t write(uint8_t data) {
         #if ARDUINO >= 100
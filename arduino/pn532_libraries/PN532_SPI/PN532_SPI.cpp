@@ -7,11 +7,13 @@
 #define DATA_WRITE      1
 #define DATA_READ       3
 
-PN532_SPI::PN532_SPI(SPIClass &spi, uint8_t ss)
+PN532_SPI::PN532_SPI(SPIClass &spi, uint8_t ss, uint8_t irq)
 {
     command = 0;
     _spi = &spi;
     _ss  = ss;
+    _irqPin = irq;
+    _statusReads = 0;
 }
 
 void PN532_SPI::begin()
@@ -29,6 +31,10 @@ void PN532_SPI::begin()
     
     digitalWrite(_ss, HIGH);  // Disattiva il chip select
     _spi->endTransaction();
+
+    // Con il pin IRQ la disponibilità dei frame non richiede traffico SPI;
+    // senza (o se il pin non supporta interrupt) si legge lo stato come prima
+    _irq.attach(_irqPin);
 }
 
 void PN532_SPI::wakeup()
@@ -45,14 +51,9 @@ int8_t PN532_SPI::writeCommand(const uint8_t *header, uint8_t hlen, const uint8_
     command = header[0];
     writeFrame(header, hlen, body, blen);
     
-    uint8_t timeout = PN532_ACK_WAIT_TIME;
-    while (!isReady()) {
-        delay(1);
-        timeout--;
-        if (0 == timeout) {
-            DMSG("Time out when waiting for ACK\n");
-            return -2;
-        }
+    if (!waitReady(PN532_ACK_WAIT_TIME)) {
+        DMSG("Time out when waiting for ACK\n");
+        return -2;
     }
     if (readAckFrame()) {
         DMSG("Invalid ACK\n");
@@ -63,15 +64,13 @@ int8_t PN532_SPI::writeCommand(const uint8_t *header, uint8_t hlen, const uint8_
 
 int16_t PN532_SPI::readResponse(uint8_t buf[], uint8_t len, uint16_t timeout)
 {
-    uint16_t time = 0;
-    while (!isReady()) {
-        delay(1);
-        time++;
-        if (timeout > 0 && time > timeout) {
-            return PN532_TIMEOUT;
-        }
+    if (!waitReady(timeout)) {
+        return PN532_TIMEOUT;
     }
 
+    if (_irq.attached()) {
+        _irq.clear();
+    }
     digitalWrite(_ss, LOW);
     delay(1);
 
@@ -140,8 +139,34 @@ int16_t PN532_SPI::readResponse(uint8_t buf[], uint8_t len, uint16_t timeout)
     return result;
 }
 
-boolean PN532_SPI::isReady()
+/**
+* @brief    wait for a frame from the PN532
+* @param    timeout max time to wait in ms, 0 means no timeout
+* @details  Polling reads the status once per ms. With the IRQ pin the
+*           check costs no bus transfer, so it runs without delay and the
+*           frame is read as soon as the PN532 asserts the line.
+*/
+bool PN532_SPI::waitReady(uint16_t timeout)
+{
+    unsigned long start = millis();
+    while (!isReady()) {
+        if (timeout > 0 && millis() - start > timeout) {
+            return false;
+        }
+        if (!_irq.attached()) {
+            delay(1);
+        }
+    }
+    return true;
+}
+
+bool PN532_SPI::isReady()
 {
+    if (_irq.attached()) {
+        return _irq.ready();
+    }
+
+    _statusReads++;
     digitalWrite(_ss, LOW);
 
     write(STATUS_READ);
@@ -197,6 +222,9 @@ int8_t PN532_SPI::readAckFrame()
 
     uint8_t ackBuf[sizeof(PN532_ACK)];
 
+    if (_irq.attached()) {
+        _irq.clear();
+    }
     digitalWrite(_ss, LOW);
     delay(1);
     write(DATA_READ);
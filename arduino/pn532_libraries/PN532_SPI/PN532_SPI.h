@@ -4,23 +4,32 @@
 
 #include <SPI.h>
 #include "PN532Interface.h"
+#include "PN532_irq.h"
 
 class PN532_SPI : public PN532Interface {
 public:
-    PN532_SPI(SPIClass &spi, uint8_t ss);
+    PN532_SPI(SPIClass &spi, uint8_t ss, uint8_t irq = PN532_NO_IRQ);
     
     void begin();
     void wakeup();
     int8_t writeCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body = 0, uint8_t blen = 0);
 
     int16_t readResponse(uint8_t buf[], uint8_t len, uint16_t timeout);
+    bool isReady();
+
+    bool irqMode() const { return _irq.attached(); }
+    uint32_t statusReads() const { return _statusReads; }
+    uint32_t irqEvents() const { return _irq.events(); }
     
 private:
     SPIClass* _spi;
     uint8_t   _ss;
+    uint8_t   _irqPin;
     uint8_t command;
+    PN532_IRQ _irq;
+    uint32_t  _statusReads;     // STATUS_READ transfers on the bus
     
-    boolean isReady();
+    bool waitReady(uint16_t timeout);
     void writeFrame(const uint8_t *header, uint8_t hlen, const uint8_t *body = 0, uint8_t blen = 0);
     int8_t readAckFrame();
     
@@ -0,0 +1,114 @@
+#ifndef ACCESS_LOG_BATCHER_H
+#define ACCESS_LOG_BATCHER_H
+
+#include <Arduino.h>
+#include "EventQueue.h"
+
+// Contatori del batcher degli accessi
+struct AccessLogStats {
+    uint32_t events;         // Eventi raggruppati
+    uint32_t batches;        // Messaggi inviati
+    uint32_t fullBatches;    // Messaggi inviati perché pieni
+    uint32_t timedBatches;   // Messaggi inviati allo scadere della finestra
+};
+
+/**
+ * @brief Raggruppa gli accessi concessi in un solo messaggio autenticato
+ * @tparam MaxEvents Eventi per messaggio
+ * @details Il primo evento apre una finestra di durata window: il blocco è
+ *          pronto quando contiene MaxEvents eventi o quando la finestra
+ *          scade, quale delle due arriva prima. Un messaggio su nfc/batch
+ *          sostituisce MaxEvents messaggi su nfc/access: una cifratura, un
+ *          MAC e una pubblicazione invece di una per tap. Gli eventi restano
+ *          in RAM; chi svuota il blocco decide se inviarli o accodarli offline.
+ */
+template <uint8_t MaxEvents>
+class AccessLogBatcher {
+private:
+    static_assert(MaxEvents > 0, "Dimensione del blocco non valida");
+
+    AccessEvent pending[MaxEvents];
+    uint8_t count;
+    uint32_t openedAt;      // millis() del primo evento del blocco
+    uint32_t window;        // Attesa massima del primo evento (ms)
+    AccessLogStats counters;
+
+public:
+    static constexpr size_t MAX_PAYLOAD = 1 + MaxEvents * EVENT_RECORD_LEN;
+
+    explicit AccessLogBatcher(uint32_t windowMs) : count(0), openedAt(0), window(windowMs) {
+        memset(pending, 0, sizeof(pending));
+        memset(&counters, 0, sizeof(counters));
+    }
+
+    void setWindow(uint32_t windowMs) { window = windowMs; }
+
+    /**
+     * @brief Aggiunge un evento al blocco
+     * @return false se il blocco è già pieno (va svuotato prima)
+     */
+    bool add(uint8_t type, const uint8_t* uid, uint8_t uidLength, uint32_t nowMs) {
+        if (count == MaxEvents) return false;
+        if (count == 0) openedAt = nowMs;
+
+        AccessEvent& event = pending[count++];
+        memset(&event, 0, sizeof(event));
+        event.type = type;
+        event.uidLength = uidLength > sizeof(event.uid) ? sizeof(event.uid) : uidLength;
+        memcpy(event.uid, uid, event.uidLength);
+        event.at = nowMs / 1000;
+        counters.events++;
+        return true;
+    }
+
+    /**
+     * @return true se il blocco è pieno o la sua finestra è scaduta
+     */
+    bool due(uint32_t nowMs) const {
+        return count == MaxEvents || (count > 0 && nowMs - openedAt >= window);
+    }
+
+    /**
+     * @brief Scrive il blocco nel formato di nfc/batch
+     * @param out Buffer di almeno MAX_PAYLOAD byte
+     * @param nowMs millis() al momento dell'invio
+     * @return Byte scritti (numero di eventi || record)
+     */
+    size_t encode(uint8_t* out, uint32_t nowMs) const {
+        size_t len = 1;
+        out[0] = count;
+        for (uint8_t i = 0; i < count; i++) {
+            len += writeEventRecord(out + len, pending[i], nowMs / 1000);
+        }
+        return len;
+    }
+
+    /**
+     * @brief Registra l'invio del blocco e lo svuota
+     */
+    void sent() {
+        counters.batches++;
+        if (count == MaxEvents) counters.fullBatches++;
+        else counters.timedBatches++;
+        clear();
+    }
+
+    void clear() { count = 0; }
+    uint8_t size() const { return count; }
+    const AccessEvent& peek(uint8_t index) const { return pending[index]; }
+    const AccessLogStats& stats() const { return counters; }
+
+    void printStats(Print& out) const {
+        out.print("[BATCH] Accessi: ");
+        out.print((unsigned long)counters.events);
+        out.print(", messaggi: ");
+        out.print((unsigned long)counters.batches);
+        out.print(" (pieni: ");
+        out.print((unsigned long)counters.fullBatches);
+        out.print(", a tempo: ");
+        out.print((unsigned long)counters.timedBatches);
+        out.println(")");
+    }
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef DOOR_LOCK_H
+#define DOOR_LOCK_H
+
+#include <Arduino.h>
+
+// Origine di una decisione di accesso
+enum DecisionSource : uint8_t {
+    DECISION_CACHE,       // Tag trovato nella cache locale
+    DECISION_SERVER,      // Risposta del server a nfc/verify
+    DECISION_FALLBACK,    // Politica locale (timeout, errore, broker assente)
+    DECISION_VERDICT      // Esito firmato del server memorizzato da un tap precedente
+};
+
+// Decisione passata al gestore registrato con NFCManager::setDecisionHandler()
+struct AccessDecision {
+    const uint8_t* uid;   // UID del tag (valido solo durante la chiamata)
+    uint8_t uidLength;
+    uint8_t reader;       // Lettore che ha letto il tag
+    bool granted;
+    DecisionSource source;
+};
+
+// Chiamato appena l'accesso è deciso, prima di log e messaggi MQTT: deve
+// tornare subito (niente delay() né pubblicazioni)
+typedef void (*AccessDecisionHandler)(const AccessDecision& decision);
+
+/**
+ * @brief Uscita digitale che apre la porta per un intervallo
+ * @details open() attiva il pin e ritorna subito; update(), chiamata a ogni
+ *          passaggio del loop, lo rilascia allo scadere dell'impulso. Un
+ *          nuovo accesso durante l'impulso lo prolunga. Senza attach() le
+ *          chiamate non hanno effetto.
+ */
+class DoorLock {
+private:
+    int16_t pin;          // -1 = nessuna uscita
+    uint8_t activeLevel;  // HIGH o LOW
+    uint32_t pulseMs;
+    uint32_t openedAt;    // millis() dell'ultima apertura
+    bool engaged;         // true mentre il pin è attivo
+    uint32_t opens;
+
+public:
+    DoorLock() : pin(-1), activeLevel(HIGH), pulseMs(0), openedAt(0), engaged(false), opens(0) {}
+
+    /**
+     * @brief Configura l'uscita e la porta nello stato di riposo
+     * @param outputPin Pin del relè o della serratura
+     * @param pulse Durata dell'apertura (ms)
+     * @param activeHigh true se il pin apre a livello alto
+     */
+    void attach(uint8_t outputPin, uint32_t pulse, bool activeHigh = true) {
+        pin = outputPin;
+        pulseMs = pulse;
+        activeLevel = activeHigh ? HIGH : LOW;
+        engaged = false;
+        pinMode(pin, OUTPUT);
+        digitalWrite(pin, activeHigh ? LOW : HIGH);
+    }
+
+    void open(uint32_t now) {
+        if (pin < 0) return;
+        digitalWrite(pin, activeLevel);
+        openedAt = now;
+        engaged = true;
+        opens++;
+    }
+
+    void update(uint32_t now) {
+        if (!engaged || now - openedAt < pulseMs) return;
+        digitalWrite(pin, activeLevel == HIGH ? LOW : HIGH);
+        engaged = false;
+    }
+
+    bool attached() const { return pin >= 0; }
+    bool isOpen() const { return engaged; }
+    uint32_t openCount() const { return opens; }
+
+    void printStats(Print& out) const {
+        if (pin < 0) {
+            out.println("[LOCK] Nessuna uscita configurata");
+            return;
+        }
+        out.print("[LOCK] Pin: ");
+        out.print((int)pin);
+        out.print(", impulso: ");
+        out.print((unsigned long)pulseMs);
+        out.print(" ms, aperture: ");
+        out.println((unsigned long)opens);
+    }
+};
+
+#endif
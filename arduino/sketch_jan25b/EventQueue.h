@@ -0,0 +1,310 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "LightweightCrypto.h"
+
+// Area EEPROM della coda eventi: subito dopo quella della cache dei tag
+#ifndef EVENT_QUEUE_EEPROM_BASE
+#define EVENT_QUEUE_EEPROM_BASE 6144
+#endif
+#ifndef EVENT_QUEUE_EEPROM_SIZE
+#define EVENT_QUEUE_EEPROM_SIZE 2048
+#endif
+
+// Tipi di evento
+#define EVENT_NONE             0  // Record perso (scrittura interrotta da un reset)
+#define EVENT_ACCESS           1  // Accesso concesso dalla cache
+#define EVENT_OFFLINE_GRANTED  2  // Tag sconosciuto accettato dalla politica locale
+#define EVENT_OFFLINE_DENIED   3  // Tag sconosciuto rifiutato dalla politica locale
+#define EVENT_VERDICT_GRANTED  4  // Concesso da un esito del server memorizzato
+#define EVENT_VERDICT_DENIED   5  // Rifiutato da un esito del server memorizzato
+
+// Istante sconosciuto: evento ripristinato da un avvio precedente
+#define EVENT_TIME_UNKNOWN 0xFFFFFFFFUL
+
+// Byte di un evento in nfc/batch: tipo || lunghezza UID || UID (7) || età in secondi (4 LE)
+#define EVENT_RECORD_LEN 13
+
+// Evento in attesa di essere inviato al server
+struct AccessEvent {
+    uint8_t type;          // EVENT_*
+    uint8_t uidLength;
+    uint8_t uid[7];
+    uint8_t reserved[3];
+    uint32_t at;           // Secondi dall'avvio, EVENT_TIME_UNKNOWN se non noto
+} __attribute__((packed));
+
+/**
+ * @brief Scrive un evento nel formato di nfc/batch
+ * @param out Buffer di almeno EVENT_RECORD_LEN byte
+ * @param event Evento da scrivere
+ * @param nowSeconds Secondi dall'avvio al momento dell'invio
+ * @return Byte scritti (EVENT_RECORD_LEN)
+ * @details Il dispositivo non ha un orologio: si invia l'età dell'evento e
+ *          il server ricava l'istante dalla ricezione
+ */
+inline size_t writeEventRecord(uint8_t* out, const AccessEvent& event, uint32_t nowSeconds) {
+    uint32_t age = event.at == EVENT_TIME_UNKNOWN ? EVENT_TIME_UNKNOWN : nowSeconds - event.at;
+    out[0] = event.type;
+    out[1] = event.uidLength;
+    memcpy(out + 2, event.uid, 7);
+    for (uint8_t b = 0; b < 4; b++) {
+        out[9 + b] = (uint8_t)(age >> (8 * b));
+    }
+    return EVENT_RECORD_LEN;
+}
+
+// Contatori della coda eventi
+struct EventQueueStats {
+    uint32_t queued;       // Eventi accodati
+    uint32_t sent;         // Eventi consegnati al server
+    uint32_t dropped;      // Eventi più vecchi scartati a coda piena
+    uint32_t restored;     // Eventi ripristinati dalla EEPROM all'avvio
+};
+
+/**
+ * @brief Coda circolare degli eventi da inviare al server
+ * @tparam Capacity Eventi conservati; a coda piena si scarta il più vecchio
+ * @details Ogni evento ha un numero di sequenza crescente che ne determina
+ *          la posizione sia in RAM sia nella copia in EEPROM (seq % Capacity),
+ *          quindi le scritture ruotano su tutta l'area. I record in EEPROM
+ *          [marker | seq | evento cifrato | MAC] sono cifrati in CTR con la
+ *          sequenza come IV; un evento inviato viene marcato come consumato
+ *          riscrivendo solo il marker. La copia in EEPROM è facoltativa:
+ *          senza begin() la coda resta solo in RAM.
+ */
+template <uint8_t Capacity>
+class EventQueue {
+public:
+    static constexpr uint8_t MAC_LEN = 4;
+    static constexpr uint8_t ENTRY_SIZE = 1 + 4 + sizeof(AccessEvent) + MAC_LEN;
+
+private:
+    static_assert(Capacity > 0, "Dimensione della coda non valida");
+
+    static constexpr uint8_t MARKER_PENDING = 0xA5;
+    static constexpr uint8_t MARKER_CONSUMED = 0x5A;
+    static constexpr uint8_t MARKER_WRITING = 0x00;
+
+    LightweightCrypto& crypto;
+    AccessEvent events[Capacity];
+    uint32_t headSeq;      // Sequenza dell'evento più vecchio
+    uint32_t nextSeq;      // Sequenza del prossimo evento
+    uint16_t base;
+    uint16_t areaSize;
+    bool persistent;
+    EventQueueStats counters;
+
+    uint16_t entryAddress(uint32_t seq) const { return base + (seq % Capacity) * ENTRY_SIZE; }
+    void sealEntry(uint32_t seq, const AccessEvent& event, uint8_t* entry);
+    bool openEntry(uint16_t addr, uint32_t& seq, AccessEvent* event);
+    void markConsumed(uint32_t seq);
+
+public:
+    EventQueue(LightweightCrypto& cipher, uint16_t eepromBase = EVENT_QUEUE_EEPROM_BASE,
+               uint16_t eepromSize = EVENT_QUEUE_EEPROM_SIZE);
+    bool begin();
+    void push(uint8_t type, const uint8_t* uid, uint8_t uidLength, uint32_t atSeconds);
+    const AccessEvent& peek(uint8_t index) const { return events[(headSeq + index) % Capacity]; }
+    void pop(uint8_t count);
+    uint8_t size() const { return (uint8_t)(nextSeq - headSeq); }
+    bool isPersistent() const { return persistent; }
+    const EventQueueStats& stats() const { return counters; }
+    void printStats(Print& out) const;
+};
+
+
+// ----------------- EventQueue Implementation -----------------
+
+
+/**
+ * @brief Costruttore della classe EventQueue
+ * @param cipher Cifrario con la chiave del dispositivo
+ * @param eepromBase Primo byte dell'area EEPROM riservata
+ * @param eepromSize Dimensione in byte dell'area EEPROM riservata
+ */
+template <uint8_t Capacity>
+EventQueue<Capacity>::EventQueue(LightweightCrypto& cipher, uint16_t eepromBase, uint16_t eepromSize)
+  : crypto(cipher), headSeq(0), nextSeq(0), base(eepromBase), areaSize(eepromSize), persistent(false)
+{
+    memset(events, 0, sizeof(events));
+    memset(&counters, 0, sizeof(counters));
+}
+
+/**
+ * @brief Attiva la copia in EEPROM e ripristina gli eventi non inviati
+ * @return true se l'area è sufficiente, false altrimenti (coda solo in RAM)
+ * @details La sequenza riparte dalla più alta trovata, anche tra i record
+ *          consumati, così un IV non viene mai riutilizzato. Gli eventi
+ *          ripristinati non hanno più un istante noto.
+ */
+template <uint8_t Capacity>
+bool EventQueue<Capacity>::begin() {
+    if ((uint32_t)Capacity * ENTRY_SIZE > areaSize ||
+        (uint32_t)base + (uint32_t)Capacity * ENTRY_SIZE > EEPROM.length()) {
+        persistent = false;
+        return false;
+    }
+
+    // Sequenza più alta tra i record integri e più vecchia tra quelli da inviare
+    bool found = false;
+    uint32_t highest = 0;
+    for (uint8_t i = 0; i < Capacity; i++) {
+        uint32_t seq;
+        if (!openEntry(base + i * ENTRY_SIZE, seq, nullptr)) continue;
+        if (!found || seq > highest) highest = seq;
+        found = true;
+    }
+    headSeq = nextSeq = found ? highest + 1 : 0;
+
+    if (found) {
+        // Gli eventi da inviare sono al più gli ultimi Capacity prima di nextSeq
+        uint32_t first = nextSeq > Capacity ? nextSeq - Capacity : 0;
+        for (uint32_t seq = first; seq < nextSeq; seq++) {
+            uint16_t addr = entryAddress(seq);
+            uint32_t stored;
+            AccessEvent& event = events[seq % Capacity];
+            if (EEPROM.read(addr) == MARKER_PENDING && openEntry(addr, stored, &event) && stored == seq) {
+                if (headSeq == nextSeq) headSeq = seq;
+                event.at = EVENT_TIME_UNKNOWN;
+                counters.restored++;
+            } else if (headSeq != nextSeq) {
+                // Buco tra eventi da inviare: record interrotto da un reset
+                memset(&event, 0, sizeof(event));
+            }
+        }
+    }
+    persistent = true;
+    return true;
+}
+
+/**
+ * @brief Cifra e autentica un evento nel formato EEPROM
+ */
+template <uint8_t Capacity>
+void EventQueue<Capacity>::sealEntry(uint32_t seq, const AccessEvent& event, uint8_t* entry) {
+    uint8_t iv[8] = {0};
+    memcpy(iv, &seq, 4);
+    iv[4] = 'E'; iv[5] = 'V'; iv[6] = 'Q';
+
+    entry[0] = MARKER_PENDING;
+    memcpy(entry + 1, &seq, 4);
+    memcpy(entry + 5, &event, sizeof(AccessEvent));
+    crypto.ctrCrypt(iv, entry + 5, sizeof(AccessEvent));
+
+    uint8_t mac[8];
+    crypto.generateMAC(entry + 1, 4 + sizeof(AccessEvent), mac);
+    memcpy(entry + 5 + sizeof(AccessEvent), mac, MAC_LEN);
+}
+
+/**
+ * @brief Legge e verifica un record della EEPROM
+ * @param addr Indirizzo del record
+ * @param seq Sequenza letta
+ * @param event Evento decifrato (può essere nullptr)
+ * @return true se il record è integro (da inviare o consumato)
+ */
+template <uint8_t Capacity>
+bool EventQueue<Capacity>::openEntry(uint16_t addr, uint32_t& seq, AccessEvent* event) {
+    uint8_t entry[ENTRY_SIZE];
+    for (uint8_t i = 0; i < ENTRY_SIZE; i++) {
+        entry[i] = EEPROM.read(addr + i);
+    }
+    if (entry[0] != MARKER_PENDING && entry[0] != MARKER_CONSUMED) return false;
+
+    uint8_t mac[8];
+    crypto.generateMAC(entry + 1, 4 + sizeof(AccessEvent), mac);
+    if (memcmp(mac, entry + 5 + sizeof(AccessEvent), MAC_LEN) != 0) return false;
+
+    memcpy(&seq, entry + 1, 4);
+    if (event) {
+        uint8_t iv[8] = {0};
+        memcpy(iv, &seq, 4);
+        iv[4] = 'E'; iv[5] = 'V'; iv[6] = 'Q';
+        memcpy(event, entry + 5, sizeof(AccessEvent));
+        crypto.ctrCrypt(iv, (uint8_t*)event, sizeof(AccessEvent));
+    }
+    return true;
+}
+
+template <uint8_t Capacity>
+void EventQueue<Capacity>::markConsumed(uint32_t seq) {
+    if (persistent) EEPROM.update(entryAddress(seq), MARKER_CONSUMED);
+}
+
+/**
+ * @brief Accoda un evento
+ * @param type EVENT_*
+ * @param uid UID del tag
+ * @param uidLength Byte dell'UID (al più 7)
+ * @param atSeconds Secondi dall'avvio
+ * @details A coda piena l'evento più vecchio viene scartato. Con la copia in
+ *          EEPROM il marker è scritto per primo come non valido e per ultimo
+ *          come valido: un record interrotto da un reset viene ignorato.
+ */
+template <uint8_t Capacity>
+void EventQueue<Capacity>::push(uint8_t type, const uint8_t* uid, uint8_t uidLength, uint32_t atSeconds) {
+    if (size() == Capacity) {
+        markConsumed(headSeq);
+        headSeq++;
+        counters.dropped++;
+    }
+
+    AccessEvent& event = events[nextSeq % Capacity];
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.uidLength = uidLength > sizeof(event.uid) ? sizeof(event.uid) : uidLength;
+    memcpy(event.uid, uid, event.uidLength);
+    event.at = atSeconds;
+
+    if (persistent) {
+        uint8_t entry[ENTRY_SIZE];
+        sealEntry(nextSeq, event, entry);
+        uint16_t addr = entryAddress(nextSeq);
+        EEPROM.update(addr, MARKER_WRITING);
+        for (uint8_t i = 1; i < ENTRY_SIZE; i++) {
+            EEPROM.update(addr + i, entry[i]);
+        }
+        EEPROM.update(addr, MARKER_PENDING);
+    }
+    nextSeq++;
+    counters.queued++;
+}
+
+/**
+ * @brief Rimuove gli eventi più vecchi dopo l'invio
+ * @param count Eventi consegnati al server
+ */
+template <uint8_t Capacity>
+void EventQueue<Capacity>::pop(uint8_t count) {
+    for (uint8_t i = 0; i < count && headSeq != nextSeq; i++) {
+        markConsumed(headSeq);
+        headSeq++;
+        counters.sent++;
+    }
+}
+
+/**
+ * @brief Stampa lo stato della coda
+ * @param out Destinazione della stampa (es. Serial)
+ */
+template <uint8_t Capacity>
+void EventQueue<Capacity>::printStats(Print& out) const {
+    out.print("[QUEUE] Eventi in coda: ");
+    out.print((unsigned)size());
+    out.print("/");
+    out.print((unsigned)Capacity);
+    out.print(persistent ? " (EEPROM)" : " (RAM)");
+    out.print(", accodati: ");
+    out.print((unsigned long)counters.queued);
+    out.print(", inviati: ");
+    out.print((unsigned long)counters.sent);
+    out.print(", scartati: ");
+    out.print((unsigned long)counters.dropped);
+    out.print(", ripristinati: ");
+    out.println((unsigned long)counters.restored);
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+
+// mallinfo() è disponibile con newlib (UNO R4, core ARM) e glibc (host)
+#if defined(__arm__) || defined(__GLIBC__)
+#include <malloc.h>
+#define HEAP_MONITOR_AVAILABLE 1
+#else
+#define HEAP_MONITOR_AVAILABLE 0
+#endif
+
+/**
+ * @brief Byte di heap attualmente allocati
+ * @return 0 dove mallinfo() non è disponibile
+ */
+inline size_t heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#elif HEAP_MONITOR_AVAILABLE
+    return mallinfo().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// Contatori dell'heap per lettura di tag
+struct HeapStats {
+    uint32_t taps;            // Letture misurate
+    uint32_t allocatingTaps;  // Letture con memoria allocata (picco o residuo diverso da zero)
+    int32_t lastPeak;         // Picco dell'ultima lettura rispetto all'inizio (byte)
+    int32_t lastDelta;        // Memoria rimasta allocata a fine lettura (byte)
+    int32_t maxPeak;          // Picco massimo osservato (byte)
+};
+
+/**
+ * @brief Misura l'heap usato durante la lettura di un tag
+ * @details begin() all'inizio della lettura, sample() nei punti in cui i
+ *          buffer del messaggio sono vivi, end() alla fine. Senza
+ *          allocazioni picco e residuo restano a zero.
+ */
+class HeapMonitor {
+private:
+    size_t start;
+    int32_t peak;
+    HeapStats counters;
+
+public:
+    HeapMonitor() : start(0), peak(0) { memset(&counters, 0, sizeof(counters)); }
+
+    void begin() {
+        start = heapInUse();
+        peak = 0;
+    }
+
+    void sample() {
+        int32_t delta = (int32_t)heapInUse() - (int32_t)start;
+        if (delta > peak) peak = delta;
+    }
+
+    /**
+     * @return Memoria rimasta allocata dall'ultima begin() (byte)
+     */
+    int32_t end() {
+        sample();
+        int32_t delta = (int32_t)heapInUse() - (int32_t)start;
+        counters.taps++;
+        counters.lastPeak = peak;
+        counters.lastDelta = delta;
+        if (peak != 0 || delta != 0) counters.allocatingTaps++;
+        if (peak > counters.maxPeak) counters.maxPeak = peak;
+        return delta;
+    }
+
+    const HeapStats& stats() const { return counters; }
+
+    void printStats(Print& out) const {
+        out.print("[HEAP] Letture: ");
+        out.print((unsigned long)counters.taps);
+        out.print(", con allocazioni: ");
+        out.print((unsigned long)counters.allocatingTaps);
+        out.print(", ultimo picco: ");
+        out.print((long)counters.lastPeak);
+        out.print(" byte, picco massimo: ");
+        out.print((long)counters.maxPeak);
+        out.println(" byte");
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef KEYSTREAM_POOL_H
+#define KEYSTREAM_POOL_H
+
+#include <Arduino.h>
+#include "LightweightCrypto.h"
+
+// Contatori del pool di keystream
+struct KeystreamStats {
+    uint32_t hits;      // Messaggi cifrati con un keystream già pronto
+    uint32_t misses;    // Messaggi cifrati a pool vuoto (keystream calcolato al momento)
+    uint32_t partial;   // Messaggi più lunghi di una voce: blocchi extra calcolati al momento
+    uint32_t refills;   // Voci generate nei tempi morti del loop
+};
+
+/**
+ * @brief Pool di keystream CTR precalcolati nei tempi morti
+ * @tparam Depth Numero di voci (IV + keystream) tenute pronte
+ * @tparam Blocks Blocchi da 8 byte di keystream per voce
+ * @details refill() genera una voce alla volta mentre il loop attende un tag;
+ *          alla lettura di un tag encrypt() consuma la voce più vecchia e la
+ *          cifratura costa solo uno XOR. Ogni voce è usata una sola volta e
+ *          azzerata subito dopo, quindi un IV non viene mai riutilizzato.
+ */
+template <uint8_t Depth, uint8_t Blocks>
+class KeystreamPool {
+private:
+    static_assert(Depth > 0 && Blocks > 0, "Dimensioni del pool non valide");
+
+    struct Entry {
+        uint8_t iv[8];
+        uint8_t stream[Blocks * 8];
+    };
+
+    LightweightCrypto& crypto;
+    Entry entries[Depth];
+    uint8_t head;       // Voce più vecchia
+    uint8_t count;      // Voci pronte
+    KeystreamStats counters;
+
+    static void randomIV(uint8_t* iv) {
+        for (uint8_t i = 0; i < 8; i++) {
+            iv[i] = random(256);
+        }
+    }
+
+public:
+    static constexpr uint8_t CAPACITY = Depth;
+    static constexpr size_t ENTRY_BYTES = Blocks * 8;
+
+    explicit KeystreamPool(LightweightCrypto& cipher) : crypto(cipher) {
+        clear();
+        memset(&counters, 0, sizeof(counters));
+    }
+
+    /**
+     * @brief Scarta tutte le voci (da chiamare se la chiave cambia)
+     */
+    void clear() {
+        memset(entries, 0, sizeof(entries));
+        head = 0;
+        count = 0;
+    }
+
+    /**
+     * @brief Genera una voce se il pool non è pieno
+     * @return true se è stata generata una voce, false se il pool è già pieno
+     * @details Costo di Blocks cifrature TEA: pensato per il loop senza tag
+     */
+    bool refill() {
+        if (count == Depth) return false;
+        Entry& entry = entries[(head + count) % Depth];
+        randomIV(entry.iv);
+        crypto.keystream(entry.iv, 0, entry.stream, Blocks);
+        count++;
+        counters.refills++;
+        return true;
+    }
+
+    /**
+     * @brief Cifra i dati in modalità CTR con un IV nuovo
+     * @param data Dati da cifrare in place
+     * @param len Lunghezza dei dati
+     * @param ivOut Riceve l'IV da trasmettere con il messaggio
+     * @details Usa la voce più vecchia del pool; a pool vuoto genera IV e
+     *          keystream al momento. Il risultato è identico a ctrCrypt().
+     */
+    void encrypt(uint8_t* data, size_t len, uint8_t ivOut[8]) {
+        if (count == 0) {
+            counters.misses++;
+            randomIV(ivOut);
+            crypto.ctrCrypt(ivOut, data, len);
+            return;
+        }
+
+        Entry& entry = entries[head];
+        head = (head + 1) % Depth;
+        count--;
+        counters.hits++;
+
+        memcpy(ivOut, entry.iv, 8);
+        size_t n = len < ENTRY_BYTES ? len : ENTRY_BYTES;
+        for (size_t i = 0; i < n; i++) data[i] ^= entry.stream[i];
+        if (len > ENTRY_BYTES) {
+            counters.partial++;
+            crypto.ctrCrypt(ivOut, data + ENTRY_BYTES, len - ENTRY_BYTES, Blocks);
+        }
+        memset(&entry, 0, sizeof(entry));
+    }
+
+    uint8_t depth() const { return count; }
+    const KeystreamStats& stats() const { return counters; }
+
+    void printStats(Print& out) const {
+        out.print("[KEYSTREAM] Profondita': ");
+        out.print((unsigned)count);
+        out.print("/");
+        out.print((unsigned)Depth);
+        out.print(", hit: ");
+        out.print((unsigned long)counters.hits);
+        out.print(", miss: ");
+        out.print((unsigned long)counters.misses);
+        out.print(", parziali: ");
+        out.println((unsigned long)counters.partial);
+    }
+};
+
+#endif
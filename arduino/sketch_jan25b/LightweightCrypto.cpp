@@ -6,8 +6,8 @@
  * @details Inizializza la chiave interna a zero per sicurezza
  * @security Assicura che non ci siano valori residui nella chiave
  */
-LightweightCrypto::LightweightCrypto() {
-    memset(key, 0, sizeof(key));
+LightweightCrypto::LightweightCrypto() : macAlgorithm(SECURE_MAC_LEGACY) {
+    setKey(key, 0);
 }
 
 /**
@@ -17,10 +17,55 @@ LightweightCrypto::LightweightCrypto() {
  * @security 
  *  - Pulisce la vecchia chiave prima di impostare la nuova
  *  - Limita la lunghezza della chiave al massimo consentito
+ * @details Scompatta la chiave TEA e precalcola lo stato del MAC dopo
+ *          l'assorbimento della chiave: cifratura e MAC successivi non
+ *          rielaborano la chiave
  */
 void LightweightCrypto::setKey(const uint8_t* newKey, size_t keyLen) {
-    memset(key, 0, sizeof(key));
-    memcpy(key, newKey, min(keyLen, sizeof(key)));
+    uint8_t newKeyCopy[16] = {0};
+    memcpy(newKeyCopy, newKey, keyLen < sizeof(key) ? keyLen : sizeof(key));
+    memcpy(key, newKeyCopy, sizeof(key));
+    memset(newKeyCopy, 0, sizeof(newKeyCopy));
+    tea.setKey(key);
+    prepareMacKey();
+}
+
+/**
+ * @brief Seleziona l'algoritmo usato da generateMAC() e macInit()
+ * @param algorithm SECURE_MAC_LEGACY (predefinito) o SECURE_MAC_SIPHASH
+ * @details La cache dei tag resta sull'hash originale, così i record già
+ *          salvati in EEPROM restano verificabili
+ */
+void LightweightCrypto::setMacAlgorithm(uint8_t algorithm) {
+    macAlgorithm = (algorithm == SECURE_MAC_SIPHASH) ? SECURE_MAC_SIPHASH : SECURE_MAC_LEGACY;
+    prepareMacKey();
+}
+
+/**
+ * @brief Precalcola lo stato iniziale del MAC per la chiave corrente
+ * @details Hash originale: stato dopo l'assorbimento della chiave.
+ *          SipHash: inizializzazione standard con k0 e k1 little-endian.
+ */
+void LightweightCrypto::prepareMacKey() {
+    memset(&keyState, 0, sizeof(keyState));
+    keyState.algorithm = macAlgorithm;
+
+    if (macAlgorithm == SECURE_MAC_SIPHASH) {
+        uint64_t k0, k1;
+        memcpy(&k0, key, 8);
+        memcpy(&k1, key + 8, 8);
+        keyState.v[0] = k0 ^ 0x736f6d6570736575ULL;
+        keyState.v[1] = k1 ^ 0x646f72616e646f6dULL;
+        keyState.v[2] = k0 ^ 0x6c7967656e657261ULL;
+        keyState.v[3] = k1 ^ 0x7465646279746573ULL;
+        return;
+    }
+
+    keyState.w[0] = 0x736f6d65;
+    keyState.w[1] = 0x646f7261;
+    keyState.w[2] = 0x6c796765;
+    keyState.w[3] = 0x74656462;
+    absorb(keyState, key, sizeof(key));
 }
 
 /**
@@ -41,9 +86,13 @@ void LightweightCrypto::xorBlock(uint8_t* data, const uint8_t* key, size_t len)
  * @param value Valore da ruotare
  * @param bits Numero di posizioni per la rotazione
  * @return Il valore ruotato
- * @details Operazione fondamentale per molti algoritmi crittografici
+ * @details Operazione fondamentale per molti algoritmi crittografici.
+ *          Una rotazione di 32 (o 0) posizioni restituisce il valore invariato:
+ *          lo scorrimento di 32 bit non è definito in C++.
  */
 uint32_t LightweightCrypto::rotateLeft(uint32_t value, uint8_t bits) {
+    bits &= 31;
+    if (bits == 0) return value;
     return (value << bits) | (value >> (32 - bits));
 }
 
@@ -55,59 +104,33 @@ uint32_t LightweightCrypto::rotateLeft(uint32_t value, uint8_t bits) {
  * @details Operazione fondamentale per molti algoritmi crittografici
  */
 uint32_t LightweightCrypto::rotateRight(uint32_t value, uint8_t bits) {
+    bits &= 31;
+    if (bits == 0) return value;
     return (value >> bits) | (value << (32 - bits));
 }
 
+static inline uint64_t rotl64(uint64_t value, uint8_t bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
 /**
- * @brief Cifra un blocco di dati usando l'algoritmo TEA
- * @param block Blocco di 8 byte da cifrare
- * @param keyBytes Chiave di cifratura di 16 byte
- * @security Implementa 32 round di cifratura TEA
- */
-void LightweightCrypto::TEA_encrypt_block(uint8_t* block, const uint8_t keyBytes[16]) {
-    uint32_t v0, v1;
-    memcpy(&v0, block, 4);
-    memcpy(&v1, block + 4, 4);
-    
-    uint32_t keyParts[4];
-    memcpy(keyParts, keyBytes, 16);
-    
-    uint32_t sum = 0;
-    uint32_t delta = 0x9E3779B9;
-    for (int i = 0; i < 32; i++) {
-        sum += delta;
-        v0 += ((v1 << 4) + keyParts[0]) ^ (v1 + sum) ^ ((v1 >> 5) + keyParts[1]);
-        v1 += ((v0 << 4) + keyParts[2]) ^ (v0 + sum) ^ ((v0 >> 5) + keyParts[3]);
-    }
-    
-    memcpy(block, &v0, 4);
-    memcpy(block + 4, &v1, 4);
-}
-
-/**
- * @brief Decifra un blocco di dati usando l'algoritmo TEA
- * @param block Blocco di 8 byte da decifrare
- * @param keyBytes Chiave di cifratura di 16 byte
- * @security Implementa 32 round di decifratura TEA
- */
-void LightweightCrypto::TEA_decrypt_block(uint8_t* block, const uint8_t keyBytes[16]) {
-    uint32_t v0, v1;
-    memcpy(&v0, block, 4);
-    memcpy(&v1, block + 4, 4);
-    
-    uint32_t keyParts[4];
-    memcpy(keyParts, keyBytes, 16);
-    
-    uint32_t delta = 0x9E3779B9;
-    uint32_t sum = delta * 32;
-    for (int i = 0; i < 32; i++) {
-        v1 -= ((v0 << 4) + keyParts[2]) ^ (v0 + sum) ^ ((v0 >> 5) + keyParts[3]);
-        v0 -= ((v1 << 4) + keyParts[0]) ^ (v1 + sum) ^ ((v1 >> 5) + keyParts[1]);
-        sum -= delta;
-    }
-    
-    memcpy(block, &v0, 4);
-    memcpy(block + 4, &v1, 4);
+ * @brief Round SipRound sui quattro registri da 64 bit
+ */
+static inline void sipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+    v0 += v1; v1 = rotl64(v1, 13); v1 ^= v0; v0 = rotl64(v0, 32);
+    v2 += v3; v3 = rotl64(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl64(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl64(v1, 17); v1 ^= v2; v2 = rotl64(v2, 32);
+}
+
+/**
+ * @brief Compressione SipHash-2-4 di una parola da 8 byte
+ */
+static inline void sipCompress(uint64_t* v, uint64_t m) {
+    v[3] ^= m;
+    sipRound(v[0], v[1], v[2], v[3]);
+    sipRound(v[0], v[1], v[2], v[3]);
+    v[0] ^= m;
 }
 
 /**
@@ -117,11 +140,12 @@ void LightweightCrypto::TEA_decrypt_block(uint8_t* block, const uint8_t keyBytes
  * @security ATTENZIONE: La modalità ECB è considerata insicura per blocchi correlati
  * @pre len deve essere multiplo di 8 bytes
  * @details Processa i dati in blocchi da 8 bytes utilizzando TEA block cipher
+ *          (TEA_ROUNDS cicli, chiave scompattata in setKey)
  */
 void LightweightCrypto::encrypt(uint8_t* data, size_t len) {
     size_t numBlocks = len / 8;
     for (size_t i = 0; i < numBlocks; i++) {
-        TEA_encrypt_block(data + i * 8, key);
+        tea.encryptBlock(data + i * 8);
     }
 }
 
@@ -136,10 +160,89 @@ void LightweightCrypto::encrypt(uint8_t* data, size_t len) {
 void LightweightCrypto::decrypt(uint8_t* data, size_t len) {
     size_t numBlocks = len / 8;
     for (size_t i = 0; i < numBlocks; i++) {
-        TEA_decrypt_block(data + i * 8, key);
+        tea.decryptBlock(data + i * 8);
     }
 }
 
+/**
+ * @brief Cifra un lotto di blocchi indipendenti con la chiave corrente
+ * @param blocks Blocchi da 8 byte consecutivi, cifrati in place
+ * @param count Numero di blocchi
+ * @details Equivale a encrypt(blocks, count * 8) ma elabora più blocchi
+ *          insieme: 8 per istruzione con AVX2, 4 con SSE2, 4 interlacciati
+ *          altrove. Pensato per l'elaborazione massiva sull'host.
+ */
+void LightweightCrypto::encryptBlocks(uint8_t* blocks, size_t count) {
+    teaBatchEncrypt(blocks, count, key, 0, TEA_ROUNDS, teaBatchBestPath());
+}
+
+/**
+ * @brief Decifra un lotto di blocchi indipendenti con la chiave corrente
+ * @details Equivale a decrypt(blocks, count * 8)
+ */
+void LightweightCrypto::decryptBlocks(uint8_t* blocks, size_t count) {
+    teaBatchDecrypt(blocks, count, key, 0, TEA_ROUNDS, teaBatchBestPath());
+}
+
+/**
+ * @brief Cifra un lotto di blocchi, ognuno con la propria chiave
+ * @param blocks Blocchi da 8 byte consecutivi, cifrati in place
+ * @param keys count chiavi da 16 byte consecutive: la chiave i cifra il blocco i
+ * @param count Numero di blocchi
+ */
+void LightweightCrypto::encryptBlocks(uint8_t* blocks, const uint8_t* keys, size_t count) {
+    teaBatchEncrypt(blocks, count, keys, 16, TEA_ROUNDS, teaBatchBestPath());
+}
+
+/**
+ * @brief Decifra un lotto di blocchi, ognuno con la propria chiave
+ * @details Parametri come encryptBlocks(blocks, keys, count)
+ */
+void LightweightCrypto::decryptBlocks(uint8_t* blocks, const uint8_t* keys, size_t count) {
+    teaBatchDecrypt(blocks, count, keys, 16, TEA_ROUNDS, teaBatchBestPath());
+}
+
+/**
+ * @brief Genera il keystream CTR per un IV
+ * @param iv IV da 8 byte del messaggio
+ * @param firstBlock Indice del primo blocco da generare
+ * @param out Buffer di output (blocks * 8 byte)
+ * @param blocks Numero di blocchi da generare
+ * @details Il blocco i è TEA(v0, v1 + i), con v0 e v1 le parole little-endian
+ *          dell'IV. Il keystream non dipende dai dati e può essere
+ *          precalcolato (KeystreamPool).
+ * @security Un IV non deve mai essere riutilizzato con la stessa chiave
+ */
+void LightweightCrypto::keystream(const uint8_t iv[8], uint32_t firstBlock, uint8_t* out, size_t blocks) {
+    uint32_t n0, n1;
+    memcpy(&n0, iv, 4);
+    memcpy(&n1, iv + 4, 4);
+    for (size_t i = 0; i < blocks; i++) {
+        uint32_t v0 = n0;
+        uint32_t v1 = n1 + firstBlock + (uint32_t)i;
+        tea.encryptWords(v0, v1);
+        memcpy(out + i * 8, &v0, 4);
+        memcpy(out + i * 8 + 4, &v1, 4);
+    }
+}
+
+/**
+ * @brief Cifra o decifra in modalità CTR (operazione identica)
+ * @param iv IV da 8 byte del messaggio
+ * @param data Dati da elaborare in place
+ * @param len Lunghezza dei dati, anche non multipla di 8
+ * @param firstBlock Indice del blocco contatore da cui partire
+ */
+void LightweightCrypto::ctrCrypt(const uint8_t iv[8], uint8_t* data, size_t len, uint32_t firstBlock) {
+    uint8_t stream[8];
+    for (size_t offset = 0; offset < len; offset += 8) {
+        keystream(iv, firstBlock++, stream, 1);
+        size_t n = len - offset < 8 ? len - offset : 8;
+        for (size_t i = 0; i < n; i++) data[offset + i] ^= stream[i];
+    }
+    memset(stream, 0, sizeof(stream));
+}
+
 /**
  * @brief Calcola hash utilizzando una versione semplificata di SipHash
  * @param data Puntatore ai dati di input
@@ -149,11 +252,29 @@ void LightweightCrypto::decrypt(uint8_t* data, size_t len) {
  * @security Fornisce 64 bit di output, adatto per MAC ma non per uso crittografico generale
  */
 void LightweightCrypto::hash(const uint8_t* data, size_t len, uint8_t* hashOut) {
-    uint32_t v0 = 0x736f6d65;
-    uint32_t v1 = 0x646f7261;
-    uint32_t v2 = 0x6c796765;
-    uint32_t v3 = 0x74656462;
-    
+    MacState state;
+    memset(&state, 0, sizeof(state));
+    state.algorithm = SECURE_MAC_LEGACY;
+    state.w[0] = 0x736f6d65;
+    state.w[1] = 0x646f7261;
+    state.w[2] = 0x6c796765;
+    state.w[3] = 0x74656462;
+    absorb(state, data, len);
+    macFinal(state, hashOut);
+}
+
+/**
+ * @brief Assorbe i dati nello stato dell'hash, un round ARX per byte
+ * @param state Stato dell'hash da aggiornare
+ * @param data Dati da assorbire
+ * @param len Lunghezza dei dati
+ */
+void LightweightCrypto::absorb(MacState& state, const uint8_t* data, size_t len) {
+    uint32_t v0 = state.w[0];
+    uint32_t v1 = state.w[1];
+    uint32_t v2 = state.w[2];
+    uint32_t v3 = state.w[3];
+
     for (size_t i = 0; i < len; i++) {
         v3 ^= data[i];
         v0 += v1;
@@ -171,9 +292,11 @@ void LightweightCrypto::hash(const uint8_t* data, size_t len, uint8_t* hashOut)
         v1 ^= v2;
         v2 = rotateLeft(v2, 32);
     }
-    
-    memcpy(hashOut, &v0, 4);
-    memcpy(hashOut + 4, &v1, 4);
+
+    state.w[0] = v0;
+    state.w[1] = v1;
+    state.w[2] = v2;
+    state.w[3] = v3;
 }
 
 /**
@@ -181,20 +304,88 @@ void LightweightCrypto::hash(const uint8_t* data, size_t len, uint8_t* hashOut)
  * @param data Dati su cui generare il MAC
  * @param len Lunghezza dei dati
  * @param mac Buffer di output per il MAC (8 byte)
- * @security Implementa MAC = hash(key || data) per garantire integrità
+ * @security Con SECURE_MAC_LEGACY: MAC = hash(key || data);
+ *           con SECURE_MAC_SIPHASH: SipHash-2-4 con chiave a 128 bit
  */
 void LightweightCrypto::generateMAC(const uint8_t* data, size_t len, uint8_t* mac) {
-    // Alloca il buffer per concatenare chiave e dati
-    uint8_t* buffer = new uint8_t[16 + len];
-    
-    // Concatena key || data
-    memcpy(buffer, key, 16);
-    memcpy(buffer + 16, data, len);
-    
-    // Genera il MAC
-    hash(buffer, 16 + len, mac);
-    
-    // Pulisci e dealloca il buffer per sicurezza
-    memset(buffer, 0, 16 + len);
-    delete[] buffer;
+    MacState state;
+    macInit(state);
+    macUpdate(state, data, len);
+    macFinal(state, mac);
+}
+
+/**
+ * @brief Inizia un MAC incrementale
+ * @param state Stato del MAC da inizializzare
+ * @details Copia lo stato precalcolato in setKey(): la chiave non viene riassorbita
+ */
+void LightweightCrypto::macInit(MacState& state) {
+    state = keyState;
+}
+
+/**
+ * @brief Aggiunge dati a un MAC incrementale
+ * @param state Stato del MAC inizializzato con macInit()
+ * @param data Dati da autenticare
+ * @param len Lunghezza dei dati
+ * @details Più chiamate consecutive equivalgono a una sola chiamata sui dati concatenati
+ */
+void LightweightCrypto::macUpdate(MacState& state, const uint8_t* data, size_t len) {
+    if (state.algorithm != SECURE_MAC_SIPHASH) {
+        absorb(state, data, len);
+        return;
+    }
+
+    state.length += len;
+
+    // Completa la parola lasciata a metà dalla chiamata precedente
+    if (state.tailLen > 0) {
+        while (state.tailLen < 8 && len > 0) {
+            state.tail[state.tailLen++] = *data++;
+            len--;
+        }
+        if (state.tailLen < 8) return;
+        uint64_t m;
+        memcpy(&m, state.tail, 8);
+        sipCompress(state.v, m);
+        state.tailLen = 0;
+    }
+
+    // Parole intere lette direttamente dai dati
+    for (; len >= 8; data += 8, len -= 8) {
+        uint64_t m;
+        memcpy(&m, data, 8);
+        sipCompress(state.v, m);
+    }
+
+    memcpy(state.tail, data, len);
+    state.tailLen = len;
+}
+
+/**
+ * @brief Conclude un MAC incrementale
+ * @param state Stato del MAC, azzerato al termine
+ * @param mac Buffer di output per il MAC (8 byte)
+ */
+void LightweightCrypto::macFinal(MacState& state, uint8_t* mac) {
+    if (state.algorithm == SECURE_MAC_SIPHASH) {
+        // Ultima parola: byte rimasti e lunghezza totale nel byte più alto
+        uint8_t last[8] = {0};
+        memcpy(last, state.tail, state.tailLen);
+        last[7] = (uint8_t)state.length;
+        uint64_t m;
+        memcpy(&m, last, 8);
+        sipCompress(state.v, m);
+
+        state.v[2] ^= 0xFF;
+        for (uint8_t i = 0; i < 4; i++) {
+            sipRound(state.v[0], state.v[1], state.v[2], state.v[3]);
+        }
+        uint64_t out = state.v[0] ^ state.v[1] ^ state.v[2] ^ state.v[3];
+        memcpy(mac, &out, 8);
+    } else {
+        memcpy(mac, &state.w[0], 4);
+        memcpy(mac + 4, &state.w[1], 4);
+    }
+    memset(&state, 0, sizeof(state));
 }
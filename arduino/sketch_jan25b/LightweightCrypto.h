@@ -1,29 +1,77 @@
 #ifndef LIGHTWEIGHT_CRYPTO_H
 #define LIGHTWEIGHT_CRYPTO_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#endif
 #include <stdint.h>
 #include <string.h>
+#include "TeaCore.h"
+#include "TeaBatch.h"
+
+// Numero di cicli TEA: deve coincidere con il server
+#define TEA_ROUNDS 32
+
+// Formato versionato dei messaggi: header || IV || ciphertext || MAC.
+// Header: modalità di cifratura nei bit 0-3, algoritmo di MAC nei bit 4-7.
+// Il formato precedente (senza header) ha sempre un numero pari di byte,
+// quello versionato dispari: il server li distingue dalla lunghezza.
+#define SECURE_MODE_ECB    0x0
+#define SECURE_MODE_CTR    0x1
+#define SECURE_MAC_LEGACY  0x0   // Hash originale, un round ARX per byte
+#define SECURE_MAC_SIPHASH 0x1   // SipHash-2-4, parole da 8 byte
+#define SECURE_HEADER(mode, mac) ((uint8_t)(((mac) << 4) | (mode)))
+
+// Stato di un MAC calcolato in modo incrementale (macInit/macUpdate/macFinal)
+struct MacState {
+    uint8_t algorithm;     // SECURE_MAC_LEGACY o SECURE_MAC_SIPHASH
+    uint8_t tailLen;       // SipHash: byte in attesa di completare una parola
+    uint8_t tail[8];
+    uint32_t length;       // SipHash: byte assorbiti in totale
+    union {
+        uint32_t w[4];     // Hash originale
+        uint64_t v[4];     // SipHash
+    };
+};
 
 class LightweightCrypto {
 private:
     uint8_t key[16];
+    TeaCore<TEA_ROUNDS> tea; // Chiave TEA già scompattata in parole da 32 bit
+    uint8_t macAlgorithm;
+    MacState keyState;     // Stato del MAC dopo l'assorbimento della chiave
     
     void xorBlock(uint8_t* data, const uint8_t* key, size_t len);
     uint32_t rotateLeft(uint32_t value, uint8_t bits);
     uint32_t rotateRight(uint32_t value, uint8_t bits);
-    
-    // Funzioni ausiliarie TEA per la cifratura di un blocco da 8 byte
-    void TEA_encrypt_block(uint8_t* block, const uint8_t keyBytes[16]);
-    void TEA_decrypt_block(uint8_t* block, const uint8_t keyBytes[16]);
+    void absorb(MacState& state, const uint8_t* data, size_t len);
+    void prepareMacKey();
     
 public:
     LightweightCrypto();
     void setKey(const uint8_t* newKey, size_t keyLen);
     void encrypt(uint8_t* data, size_t len);
     void decrypt(uint8_t* data, size_t len);
+
+    // Lotti di blocchi indipendenti (ECB): percorsi SSE2/AVX2 sull'host x86
+    void encryptBlocks(uint8_t* blocks, size_t count);
+    void decryptBlocks(uint8_t* blocks, size_t count);
+    // Una chiave da 16 byte per ogni blocco, consecutive in keys
+    static void encryptBlocks(uint8_t* blocks, const uint8_t* keys, size_t count);
+    static void decryptBlocks(uint8_t* blocks, const uint8_t* keys, size_t count);
+
+    // CTR: blocco contatore = IV con la seconda parola incrementata di uno per blocco
+    void keystream(const uint8_t iv[8], uint32_t firstBlock, uint8_t* out, size_t blocks);
+    void ctrCrypt(const uint8_t iv[8], uint8_t* data, size_t len, uint32_t firstBlock = 0);
     void hash(const uint8_t* data, size_t len, uint8_t* hashOut);
     void generateMAC(const uint8_t* data, size_t len, uint8_t* mac);
+    void setMacAlgorithm(uint8_t algorithm);
+    uint8_t getMacAlgorithm() const { return macAlgorithm; }
+
+    // MAC incrementale: equivalente a generateMAC sulla concatenazione dei dati
+    void macInit(MacState& state);
+    void macUpdate(MacState& state, const uint8_t* data, size_t len);
+    void macFinal(MacState& state, uint8_t* mac);
 };
 
 #endif
@@ -0,0 +1,4 @@
+#include "Log.h"
+
+// Buffer dei log condiviso da sketch e librerie dello sketch
+LogBuffer Log;
@@ -0,0 +1,134 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+
+// Livelli di log: i messaggi sopra LOG_LEVEL non vengono compilati
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Byte del buffer circolare dei messaggi
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 512
+#endif
+// Byte inviati alla seriale per ogni chiamata a drain()
+#ifndef LOG_DRAIN_CHUNK
+#define LOG_DRAIN_CHUNK 64
+#endif
+// 1 per i core senza availableForWrite() (sempre 0): drain() invia comunque
+// LOG_DRAIN_CHUNK byte e può attendere la seriale
+#ifndef LOG_DRAIN_UNCHECKED
+#define LOG_DRAIN_UNCHECKED 0
+#endif
+
+#define LOG_ENABLED(level) ((level) <= LOG_LEVEL)
+
+// Uso: LOG_INFO.println("[RESULT] ACCESS GRANTED");
+// Con il livello disabilitato l'istruzione è codice morto e il compilatore
+// la elimina insieme agli argomenti. La forma if/else evita che un else
+// successivo si leghi alla condizione della macro.
+#define LOG_AT(level) if (!LOG_ENABLED(level)) {} else Log
+#define LOG_ERROR LOG_AT(LOG_LEVEL_ERROR)
+#define LOG_WARN  LOG_AT(LOG_LEVEL_WARN)
+#define LOG_INFO  LOG_AT(LOG_LEVEL_INFO)
+#define LOG_DEBUG LOG_AT(LOG_LEVEL_DEBUG)
+
+/**
+ * @brief Destinazione dei log con buffer circolare
+ * @details write() copia i byte nel buffer e ritorna subito: le letture dei
+ *          tag non attendono la seriale. drain(), chiamata dal loop quando
+ *          non ci sono tag, invia al più LOG_DRAIN_CHUNK byte per volta.
+ *          A buffer pieno i nuovi byte vengono scartati e contati; il
+ *          conteggio viene segnalato alla successiva drain().
+ */
+class LogBuffer : public Print {
+private:
+    uint8_t buffer[LOG_BUFFER_SIZE];
+    uint16_t head;      // Prossimo byte da inviare
+    uint16_t count;     // Byte in attesa
+    uint32_t dropped;   // Byte scartati dall'ultima segnalazione
+
+    // Invia al più limit byte senza controllare lo spazio nella destinazione
+    size_t send(Print& out, size_t limit) {
+        if (dropped && count == 0) {
+            uint32_t lost = dropped;
+            dropped = 0;
+            out.print("\n[LOG] Byte persi: ");
+            out.println((unsigned long)lost);
+        }
+
+        size_t sent = 0;
+        while (sent < limit && count > 0) {
+            // Parte contigua del buffer circolare
+            size_t n = LOG_BUFFER_SIZE - head;
+            if (n > count) n = count;
+            if (n > limit - sent) n = limit - sent;
+            size_t written = out.write(buffer + head, n);
+            head = (head + written) % LOG_BUFFER_SIZE;
+            count -= written;
+            sent += written;
+            if (written < n) break;
+        }
+        return sent;
+    }
+
+public:
+    LogBuffer() : head(0), count(0), dropped(0) {}
+
+    size_t write(uint8_t c) override {
+        if (count == LOG_BUFFER_SIZE) {
+            dropped++;
+            return 0;
+        }
+        buffer[(head + count) % LOG_BUFFER_SIZE] = c;
+        count++;
+        return 1;
+    }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        size_t n = 0;
+        while (n < len && count < LOG_BUFFER_SIZE) {
+            buffer[(head + count) % LOG_BUFFER_SIZE] = data[n++];
+            count++;
+        }
+        dropped += len - n;
+        return n;
+    }
+
+    /**
+     * @brief Invia alla seriale una parte dei messaggi in attesa
+     * @param out Destinazione (es. Serial)
+     * @return Byte inviati
+     * @details Si ferma allo spazio libero nel buffer di trasmissione, così
+     *          la chiamata non blocca: con il buffer pieno non invia nulla
+     */
+    size_t drain(Print& out) {
+        int room = out.availableForWrite();
+#if LOG_DRAIN_UNCHECKED
+        if (room <= 0) room = LOG_DRAIN_CHUNK;
+#endif
+        if (room <= 0) return 0;
+        return send(out, (size_t)room < LOG_DRAIN_CHUNK ? (size_t)room : LOG_DRAIN_CHUNK);
+    }
+
+    /**
+     * @brief Invia tutti i messaggi in attesa (es. prima di un riavvio)
+     * @details Attende la seriale
+     */
+    void flush() override {
+        while (send(Serial, LOG_DRAIN_CHUNK) > 0) {}
+    }
+
+    uint16_t pending() const { return count; }
+};
+
+extern LogBuffer Log;
+
+#endif
@@ -1,307 +1,342 @@
 #include "NFCSecure.h"
 
-// ----------------- SecureTagCache Implementation -----------------
+// ----------------- NFCManager Implementation -----------------
 
 
 /**
- * @brief Costruttore della classe SecureTagCache
- * @details Inizializza la cache con una chiave di default di 16 byte. 
- * @security TODO: La chiave dovrebbe essere caricata da un secure storage invece che essere hardcoded
+ * @brief Costruttore della classe NFCManager
+ * @param nfcReader Riferimento al lettore NFC
+ * @param tagCache Riferimento alla cache dei tag
+ * @param mqttClient Riferimento al client MQTT
+ * @security Inizializza una chiave di cifratura per le comunicazioni MQTT
+ */
+NFCManager::NFCManager(NFCReader& nfcReader, SecureTagCache& tagCache, MqttClient& mqttClient)
+  : NFCManager(&singleReader, 1, tagCache, mqttClient)
+{
+    singleReader = &nfcReader;
+}
+
+/**
+ * @brief Costruttore per più lettori (ad esempio ingresso e uscita)
+ * @param nfcReaders Array di puntatori ai lettori, deve restare valido
+ * @param count Numero di lettori (almeno 1)
+ * @param tagCache Riferimento alla cache dei tag
+ * @param mqttClient Riferimento al client MQTT
  */
-SecureTagCache::SecureTagCache() : numTags(0) {
-    // SECURITY: La chiave dovrebbe essere caricata da un secure storage
-    uint8_t key[16] = {0x42}; // TODO: Implementare secure storage
+NFCManager::NFCManager(NFCReader* const* nfcReaders, uint8_t count, SecureTagCache& tagCache, MqttClient& mqttClient)
+  : singleReader(nullptr), readers(nfcReaders), readerCount(count), nextReader(0),
+    cache(tagCache), mqtt(mqttClient), keystreamPool(crypto),
+    cipherMode(SECURE_MODE_CTR), binaryFrames(true),
+    verifyTimeout(VERIFY_TIMEOUT_MS), verifyFallback(VERIFY_FALLBACK), events(crypto), lastFlush(0),
+    accessLog(ACCESS_BATCH_WINDOW_MS), lastMetrics(0), tapStart(0), inTap(false),
+    currentReader(0), decisionHandler(nullptr), presence(NFC_RETRIGGER_MS),
+    isAdmin(false), uidLength(0), rounds(0)
+{
+    // Inizializza la chiave con lo stesso valore usato nel server
+    uint8_t tempKey[] = {0x01,0x23,0x45,0x67,0x89,0xAB,0xCD,0xEF,
+                        0x01,0x23,0x45,0x67,0x89,0xAB,0xCD,0xEF};
+    memcpy(key, tempKey, 16);
     crypto.setKey(key, 16);
+    crypto.setMacAlgorithm(SECURE_MAC_SIPHASH);
 }
 
 
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
 /**
- * @brief Aggiunge un nuovo tag NFC alla cache sicura di Arduino
- * @param uid Array di byte contenente l'identificativo univoco del tag NFC
- * @return true se il tag è stato aggiunto con successo, false altrimenti
- * @security Implementa:
- *  - Generazione sicura di IV casuali
- *  - Cifratura dei dati con algoritmo TEA (Tiny Encryption Algorithm)
- *  - Generazione MAC per integrità
- */
-bool SecureTagCache::addTag(const uint8_t* uid) {
-    // Controlla se il tag è già in cache
-    for (uint8_t i = 0; i < numTags; i++) {
-        uint8_t derivedKey8[8];
-        crypto.hash(cache[i].iv, 8, derivedKey8);
-        uint8_t fullKey[16];
-        memcpy(fullKey, derivedKey8, 8);
-        memcpy(fullKey + 8, derivedKey8, 8);
-        crypto.setKey(fullKey, 16);
-        
-        crypto.decrypt(cache[i].data, 32);
-        TagEntry existingTag;
-        memcpy(&existingTag, cache[i].data, sizeof(TagEntry));
-        
-        // Se il tag esiste già, non aggiungere duplicati
-        if (memcmp(existingTag.uid, uid, 7) == 0) {
-            // Ripristina lo stato crittato precedente
-            crypto.encrypt(cache[i].data, 32);
-            return true;
-        }
+ * @brief Converte in place n byte in 2n cifre esadecimali
+ * @param buf Buffer di almeno 2n byte con i dati nei primi n
+ * @details Procede dall'ultimo byte al primo: ogni coppia di cifre viene
+ *          scritta su byte già convertiti, quindi non serve un secondo buffer
+ */
+static void hexExpandInPlace(uint8_t* buf, size_t n) {
+    for (size_t i = n; i-- > 0;) {
+        uint8_t b = buf[i];
+        buf[2 * i] = HEX_DIGITS[b >> 4];
+        buf[2 * i + 1] = HEX_DIGITS[b & 0x0F];
     }
+}
 
-    // Se la cache è piena, cerca uno slot libero o sovrascrivi il meno usato
-    if (numTags >= MAX_TAGS) {
-        uint16_t minUses = UINT16_MAX;
-        int replaceIdx = -1;
-        TagEntry temp;
-        
-        for (uint8_t i = 0; i < MAX_TAGS; i++) {
-            uint8_t derivedKey8[8];
-            crypto.hash(cache[i].iv, 8, derivedKey8);
-            uint8_t fullKey[16];
-            memcpy(fullKey, derivedKey8, 8);
-            memcpy(fullKey + 8, derivedKey8, 8);
-            crypto.setKey(fullKey, 16);
-            
-            crypto.decrypt(cache[i].data, 32);
-            memcpy(&temp, cache[i].data, sizeof(TagEntry));
-            
-            if (temp.useCount < minUses) {
-                minUses = temp.useCount;
-                replaceIdx = i;
-            }
-        }
-        
-        if (replaceIdx >= 0) {
-            // Prepara nuovo tag
-            TagEntry newTag = {0};
-            memcpy(newTag.uid, uid, 7);
-            newTag.lastUsed = millis();
-            newTag.useCount = 1;
-            newTag.valid = true;
-            
-            // Genera nuovo IV
-            for (int i = 0; i < 8; i++) {
-                cache[replaceIdx].iv[i] = random(256);
-            }
-            
-            // Deriva chiave
-            uint8_t derivedKey8[8];
-            crypto.hash(cache[replaceIdx].iv, 8, derivedKey8);
-            uint8_t fullKey[16];
-            memcpy(fullKey, derivedKey8, 8);
-            memcpy(fullKey + 8, derivedKey8, 8);
-            crypto.setKey(fullKey, 16);
-            
-            // Cripta e aggiungi MAC
-            memset(cache[replaceIdx].data, 0, 32);
-            memcpy(cache[replaceIdx].data, &newTag, sizeof(TagEntry));
-            crypto.encrypt(cache[replaceIdx].data, 32);
-            crypto.generateMAC(cache[replaceIdx].data, 32, cache[replaceIdx].mac);
-            
-            return true;
-        }
-        return false;
-    }
+/**
+ * @brief Cifra e autentica i dati dopo un prefisso già scritto nel buffer
+ * @param data Dati in chiaro (non sovrapposti a out)
+ * @param len Lunghezza dei dati
+ * @param out Buffer con il prefisso nei primi prefixLen byte, dimensione già verificata
+ * @param prefixLen Byte di prefisso (header o versione || flags), coperti dal MAC
+ * @return Byte scritti (prefisso || IV || ciphertext || MAC)
+ * @details I dati vengono copiati e cifrati direttamente nel buffer di output,
+ *          allineati a 8 byte con zeri come in ECB. In modalità CTR il
+ *          keystream viene preso dal pool riempito da idle(): alla lettura
+ *          di un tag la cifratura costa solo uno XOR. Nessuna allocazione.
+ * @security Il MAC (SipHash-2-4) copre anche il prefisso: versione, modalità
+ *           e algoritmo non possono essere alterati
+ */
+size_t NFCManager::sealSecureFrame(const uint8_t* data, size_t len, uint8_t* out, size_t prefixLen) {
+    size_t paddedLen = SECURE_PADDED_LEN(len);
+
+    uint8_t* iv = out + prefixLen;
+    uint8_t* encrypted = iv + 8;
+    uint8_t* mac = encrypted + paddedLen;
+
+    // 1. Padding dei dati a multiplo di 8 bytes (blocco TEA)
+    memcpy(encrypted, data, len);
+    memset(encrypted + len, 0, paddedLen - len);  // Padding con zeri
     
-    // Aggiunta di un nuovo tag quando c'è spazio
-    for (int i = 0; i < 8; i++) {
-        cache[numTags].iv[i] = random(256);
+    // 2. Cifra i dati in place con un IV nuovo
+    if (cipherMode == SECURE_MODE_CTR) {
+        keystreamPool.encrypt(encrypted, paddedLen, iv);
+    } else {
+        for (int i = 0; i < 8; i++) {
+            iv[i] = random(256);
+        }
+        crypto.encrypt(encrypted, paddedLen);
     }
     
-    TagEntry newTag = {0};
-    memcpy(newTag.uid, uid, 7);
-    newTag.lastUsed = millis();
-    newTag.useCount = 1;
-    newTag.valid = true;
-    
-    uint8_t derivedKey8[8];
-    crypto.hash(cache[numTags].iv, 8, derivedKey8);
-    uint8_t fullKey[16];
-    memcpy(fullKey, derivedKey8, 8);
-    memcpy(fullKey + 8, derivedKey8, 8);
-    crypto.setKey(fullKey, 16);
+    // 3. MAC su prefisso || IV || ciphertext, contigui nel buffer
+    MacState macState;
+    crypto.macInit(macState);
+    crypto.macUpdate(macState, out, prefixLen + 8 + paddedLen);
+    crypto.macFinal(macState, mac);
     
-    memset(cache[numTags].data, 0, 32);
-    memcpy(cache[numTags].data, &newTag, sizeof(TagEntry));
-    crypto.encrypt(cache[numTags].data, 32);
-    crypto.generateMAC(cache[numTags].data, 32, cache[numTags].mac);
-    
-    numTags++;
-    return true;
+    return prefixLen + 8 + paddedLen + 8;
 }
 
-
 /**
- * @brief Verifica se un tag NFC è presente nella cache e se è valido
- * @param uid Array di byte contenente l'identificativo univoco del tag da verificare
- * @return true se il tag è valido e presente in cache, false altrimenti
- * @security Implementa:
- *  - Verifica dell'integrità tramite MAC
- *  - Decifratura sicura dei dati
- *  - Logging non sensibile delle operazioni
- */
-bool SecureTagCache::verifyTag(const uint8_t* uid) {
-
-    Serial.print("Numero di tag in cache: ");
-    Serial.println(numTags);
-
-    TagEntry tag;
-    for (uint8_t i = 0; i < numTags; i++) {
-        // Crea copie dei dati per non modificare l'originale
-        uint8_t tempIV[8];
-        uint8_t tempData[32];
-        uint8_t tempMac[8];
-        
-        memcpy(tempIV, cache[i].iv, 8);
-        memcpy(tempData, cache[i].data, 32);
-        memcpy(tempMac, cache[i].mac, 8);
-
-        uint8_t derivedKey8[8];
-        crypto.hash(tempIV, 8, derivedKey8);
-        uint8_t fullKey[16];
-        memcpy(fullKey, derivedKey8, 8);
-        memcpy(fullKey + 8, derivedKey8, 8);
-        crypto.setKey(fullKey, 16);
-        
-        uint8_t calculatedMac[8];
-        crypto.generateMAC(tempData, 32, calculatedMac);
-        bool integrityOk = (memcmp(calculatedMac, tempMac, 8) == 0);
-        
-        crypto.decrypt(tempData, 32);
-        memcpy(&tag, tempData, sizeof(TagEntry));
-                
-        
-        if (tag.valid && (memcmp(tag.uid, uid, 7) == 0) && integrityOk) {
-            Serial.println("Tag verificato con successo!");
-            return true;
-        }
+ * @brief Cifra e autentica un messaggio nel frame binario
+ * @param data Dati in chiaro (non sovrapposti a out)
+ * @param len Lunghezza dei dati
+ * @param out Buffer di output, almeno SECURE_FRAME_LEN(len) byte
+ * @param outSize Dimensione del buffer di output
+ * @param requestId ID della richiesta da riportare nella risposta, 0 se non serve
+ * @return Byte scritti (versione || flags || [ID] || IV || ciphertext || MAC), 0 se il buffer è insufficiente
+ * @details Metà della dimensione del messaggio esadecimale e nessuna
+ *          conversione in testo; i flags hanno lo stesso formato dell'header.
+ *          Con un ID il frame usa la versione SECURE_FRAME_VERSION_ID.
+ * @security L'ID fa parte del prefisso coperto dal MAC
+ */
+size_t NFCManager::prepareSecureFrame(const uint8_t* data, size_t len, uint8_t* out, size_t outSize, uint16_t requestId) {
+    size_t prefixLen = requestId ? 4 : 2;
+    if (SECURE_FRAME_LEN(len) + prefixLen - 2 > outSize) return 0;
+
+    out[0] = requestId ? SECURE_FRAME_VERSION_ID : SECURE_FRAME_VERSION;
+    out[1] = SECURE_HEADER(cipherMode, crypto.getMacAlgorithm());
+    if (requestId) {
+        out[2] = requestId & 0xFF;
+        out[3] = requestId >> 8;
     }
-    
-    Serial.println("Verifica tag fallita");
-    return false;
+    return sealSecureFrame(data, len, out, prefixLen);
 }
 
+/**
+ * @brief Cifra e autentica un messaggio in esadecimale
+ * @param data Dati in chiaro (non sovrapposti a out)
+ * @param len Lunghezza dei dati
+ * @param out Buffer di output, almeno SECURE_MESSAGE_LEN(len) + 1 caratteri
+ * @param outSize Dimensione del buffer di output
+ * @return Caratteri scritti senza terminatore, 0 se il buffer è insufficiente
+ * @details Formato usato per le credenziali MQTT e dai broker precedenti al
+ *          frame binario. Il frame (header || IV || ciphertext || MAC) viene
+ *          costruito all'inizio del buffer e poi espanso in place con una
+ *          tabella di cifre. Nessuna allocazione.
+ */
+size_t NFCManager::prepareSecureMessage(const uint8_t* data, size_t len, char* out, size_t outSize) {
+    size_t messageLen = SECURE_MESSAGE_LEN(len);
+    if (messageLen + 1 > outSize) return 0;
+
+    uint8_t* frame = (uint8_t*)out;
+    frame[0] = SECURE_HEADER(cipherMode, crypto.getMacAlgorithm());
+    size_t frameLen = sealSecureFrame(data, len, frame, 1);
+    hexExpandInPlace(frame, frameLen);
+    out[messageLen] = '\0';
+    return messageLen;
+}
 
 /**
- * @brief Salva lo stato della cache nella memoria EEPROM
- * @return true se il salvataggio è avvenuto con successo, false altrimenti
- * @security I dati sono già cifrati prima del salvataggio
+ * @brief Cifra e autentica un messaggio in una String
+ * @return Messaggio in esadecimale, vuoto se i dati superano SECURE_MESSAGE_MAX_DATA
+ * @details Usata per le credenziali MQTT, che il client richiede come String:
+ *          una sola allocazione per il risultato
  */
-bool SecureTagCache::saveToEEPROM() {
-    EEPROM.put(0, EEPROM_MAGIC);
-    EEPROM.put(2, numTags);
-    for (uint8_t i = 0; i < numTags; i++) {
-        EEPROM.put(4 + (i * sizeof(EncryptedData)), cache[i]);
-    }
-    return true;
+String NFCManager::prepareSecureMessage(const uint8_t* data, size_t len) {
+    char message[SECURE_MESSAGE_LEN(SECURE_MESSAGE_MAX_DATA) + 1];
+    if (len > SECURE_MESSAGE_MAX_DATA || !prepareSecureMessage(data, len, message, sizeof(message)))
+        return String();
+    return String(message);
 }
 
+
 /**
- * @brief Carica lo stato della cache dalla memoria EEPROM
- * @return true se il caricamento è avvenuto con successo, false altrimenti
- * @security Verifica la validità dei dati tramite magic number
+ * @brief Cifra un messaggio e lo pubblica sul topic
+ * @param requestId ID della richiesta (solo frame binario), 0 se non serve
+ * @return true se il messaggio è stato consegnato al client MQTT
+ * @details Di norma invia il frame binario (26 byte per un UID invece di
+ *          50 caratteri); con setBinaryFrames(false) il messaggio
+ *          esadecimale, che non trasporta l'ID. La lunghezza è nota in
+ *          anticipo: il messaggio viene scritto dal buffer sullo stack
+ *          direttamente nel client MQTT
  */
-bool SecureTagCache::loadFromEEPROM() {
-    uint16_t magic;
-    EEPROM.get(0, magic);
-    if (magic != EEPROM_MAGIC) return false;
-    EEPROM.get(2, numTags);
-    if (numTags > MAX_TAGS) {
-        numTags = 0;
+bool NFCManager::sendSecureMessage(const char* topic, const uint8_t* data, size_t len, uint16_t requestId) {
+    char message[SECURE_MESSAGE_LEN(SECURE_MESSAGE_MAX_DATA) + 1];
+    uint32_t start = micros();
+    size_t messageLen = binaryFrames
+        ? prepareSecureFrame(data, len, (uint8_t*)message, sizeof(message), requestId)
+        : prepareSecureMessage(data, len, message, sizeof(message));
+    if (messageLen == 0) {
+        LOG_ERROR.println("[MQTT] Messaggio troppo lungo, non inviato");
         return false;
     }
-    for (uint8_t i = 0; i < numTags; i++) {
-        EEPROM.get(4 + (i * sizeof(EncryptedData)), cache[i]);
+    heap.sample();
+    uint32_t sealed = micros();
+    
+    if (!mqtt.beginMessage(topic, (unsigned long)messageLen)) return false;
+    mqtt.write((const uint8_t*)message, messageLen);
+    bool ok = mqtt.endMessage();
+
+    // Solo i messaggi di una lettura: metriche e log in background non contano
+    if (inTap) {
+        metrics.record(TAP_STAGE_SEAL, sealed - start);
+        metrics.record(TAP_STAGE_PUBLISH, micros() - sealed);
     }
-    return true;
+    return ok;
 }
 
+/**
+ * @brief Lavoro in background da eseguire quando non ci sono tag
+ * @details Precalcola una voce di keystream CTR per il prossimo messaggio,
+ *          invia il blocco di accessi se la finestra è scaduta e un blocco di
+ *          eventi in coda se il broker è raggiungibile
+ */
+void NFCManager::idle() {
+    keystreamPool.refill();
+    flushAccessLog();
+    flushEvents();
+    publishMetrics();
+}
 
+/**
+ * @brief Pubblica gli istogrammi delle fasi di lettura e li azzera
+ * @details Ogni TAP_METRICS_INTERVAL_MS un messaggio su nfc/metrics per
+ *          ogni fase con campioni; il server ne ricava p50 e p99 per
+ *          dispositivo e per l'intera flotta. Senza broker gli istogrammi
+ *          continuano ad accumulare fino alla prossima pubblicazione.
+ */
+void NFCManager::publishMetrics() {
+#if TAP_METRICS_INTERVAL_MS > 0
+    uint32_t now = millis();
+    if (now - lastMetrics < TAP_METRICS_INTERVAL_MS || !mqtt.connected()) return;
+    lastMetrics = now;
+
+    uint8_t payload[TAP_METRICS_PAYLOAD_MAX];
+    bool sent = true;
+    for (uint8_t s = 0; s < TAP_STAGE_COUNT; s++) {
+        size_t len = metrics.encode((TapStage)s, payload);
+        if (len && !sendSecureMessage("nfc/metrics", payload, len)) sent = false;
+    }
+    if (sent) metrics.reset();
+#endif
+}
 
+/**
+ * @brief Invia il blocco di accessi concessi se è pieno o la finestra è scaduta
+ * @details Un solo messaggio su nfc/batch per blocco. Se il broker non è
+ *          raggiungibile o l'invio fallisce gli eventi passano alla coda
+ *          offline, che li conserva e li reinvia alla riconnessione.
+ */
+void NFCManager::flushAccessLog() {
+    if (accessLog.size() == 0) return;
+    uint32_t now = millis();
+    bool online = mqtt.connected();
+    if (online && !accessLog.due(now)) return;
 
+    if (online) {
+        uint8_t batch[NFCAccessLog::MAX_PAYLOAD];
+        size_t len = accessLog.encode(batch, now);
+        if (sendSecureMessage("nfc/batch", batch, len)) {
+            accessLog.sent();
+            return;
+        }
+    }
+    for (uint8_t i = 0; i < accessLog.size(); i++) {
+        const AccessEvent& event = accessLog.peek(i);
+        events.push(event.type, event.uid, event.uidLength, event.at);
+    }
+    accessLog.clear();
+}
 
+/**
+ * @brief Invia al server un blocco di eventi accodati offline
+ * @details Al più EVENT_BATCH_MAX eventi per messaggio su nfc/batch e un
+ *          messaggio ogni EVENT_FLUSH_INTERVAL_MS: dopo una riconnessione la
+ *          coda si svuota a ritmo controllato invece di inviare un messaggio
+ *          per evento. Il primo blocco parte un intervallo dopo la
+ *          riconnessione. Gli eventi restano in coda se l'invio fallisce.
+ */
+void NFCManager::flushEvents() {
+    uint32_t now = millis();
+    if (!mqtt.connected()) {
+        lastFlush = now;
+        return;
+    }
+    if (events.size() == 0 || now - lastFlush < EVENT_FLUSH_INTERVAL_MS) return;
+    lastFlush = now;
 
-// ----------------- NFCManager Implementation -----------------
+    uint8_t batch[1 + EVENT_BATCH_MAX * EVENT_RECORD_LEN];
+    uint8_t count = events.size() < EVENT_BATCH_MAX ? events.size() : EVENT_BATCH_MAX;
+    size_t len = 1;
+    batch[0] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        len += writeEventRecord(batch + len, events.peek(i), now / 1000);
+    }
 
+    if (sendSecureMessage("nfc/batch", batch, len)) {
+        events.pop(count);
+    }
+}
 
 /**
- * @brief Costruttore della classe NFCManager
- * @param nfcReader Riferimento al lettore NFC
- * @param tagCache Riferimento alla cache dei tag
- * @param mqttClient Riferimento al client MQTT
- * @security Inizializza una chiave di cifratura per le comunicazioni MQTT
+ * @brief Seleziona la modalità di cifratura dei messaggi
+ * @param mode SECURE_MODE_CTR (predefinita) o SECURE_MODE_ECB
  */
-NFCManager::NFCManager(NFCReader& nfcReader, SecureTagCache& tagCache, MqttClient& mqttClient)
-  : nfc(nfcReader), cache(tagCache), mqtt(mqttClient), isAdmin(false), uidLength(0), rounds(0)
-{
-    // Inizializza la chiave con lo stesso valore usato nel server
-    uint8_t tempKey[] = {0x01,0x23,0x45,0x67,0x89,0xAB,0xCD,0xEF,
-                        0x01,0x23,0x45,0x67,0x89,0xAB,0xCD,0xEF};
-    memcpy(key, tempKey, 16);
-    crypto.setKey(key, 16);
+void NFCManager::setCipherMode(uint8_t mode) {
+    cipherMode = (mode == SECURE_MODE_ECB) ? SECURE_MODE_ECB : SECURE_MODE_CTR;
 }
 
+/**
+ * @brief Seleziona il formato dei messaggi su nfc/access e nfc/verify
+ * @param enabled true (predefinito) per il frame binario, false per
+ *        l'esadecimale accettato anche dai broker precedenti
+ */
+void NFCManager::setBinaryFrames(bool enabled) {
+    binaryFrames = enabled;
+}
 
-String NFCManager::prepareSecureMessage(const uint8_t* data, size_t len) {
-    // 1. Genera IV random
-    uint8_t iv[8];
-    for (int i = 0; i < 8; i++) {
-        iv[i] = random(256);
-    }
-    
-    // 2. Padding dei dati a multiplo di 8 bytes (blocco TEA)
-    size_t paddedLen = ((len + 7) / 8) * 8;
-    uint8_t* paddedData = new uint8_t[paddedLen];
-    memset(paddedData, 0, paddedLen);  // Padding con zeri
-    memcpy(paddedData, data, len);
-    
-    // 3. Cifra i dati
-    uint8_t* encrypted = new uint8_t[paddedLen];
-    memcpy(encrypted, paddedData, paddedLen);
-    crypto.setKey(key, 16);
-    crypto.encrypt(encrypted, paddedLen);
-    
-    // 4. Genera MAC su IV || ciphertext
-    uint8_t mac[8];
-    uint8_t* macData = new uint8_t[8 + paddedLen];
-    memcpy(macData, iv, 8);
-    memcpy(macData + 8, encrypted, paddedLen);
-    crypto.generateMAC(macData, 8 + paddedLen, mac);
-    
-    // 5. Prepara stringa risultato
-    String result;
-    
-    // IV
-    for (int i = 0; i < 8; i++) {
-        if (iv[i] < 0x10) result += '0';
-        result += String(iv[i], HEX);
-    }
-    
-    // Ciphertext
-    for (size_t i = 0; i < paddedLen; i++) {
-        if (encrypted[i] < 0x10) result += '0';
-        result += String(encrypted[i], HEX);
-    }
-    
-    // MAC
-    for (int i = 0; i < 8; i++) {
-        if (mac[i] < 0x10) result += '0';
-        result += String(mac[i], HEX);
-    }
-    
-    // Pulizia memoria
-    delete[] paddedData;
-    delete[] encrypted;
-    delete[] macData;
-    
-    return result;
+/**
+ * @brief Imposta l'attesa massima della risposta a nfc/verify
+ * @param timeoutMs Millisecondi; si applica alle richieste successive
+ */
+void NFCManager::setVerifyTimeout(uint32_t timeoutMs) {
+    verifyTimeout = timeoutMs;
 }
 
+/**
+ * @brief Imposta la decisione locale se il server non risponde in tempo
+ * @param policy VERIFY_FALLBACK_DENY (predefinita) o VERIFY_FALLBACK_GRANT
+ * @security Con VERIFY_FALLBACK_GRANT un tag sconosciuto viene accettato
+ *           quando il server è irraggiungibile: da usare solo dove la
+ *           disponibilità conta più del controllo degli accessi
+ */
+void NFCManager::setVerifyFallback(uint8_t policy) {
+    verifyFallback = (policy == VERIFY_FALLBACK_GRANT) ? VERIFY_FALLBACK_GRANT : VERIFY_FALLBACK_DENY;
+}
 
-void NFCManager::sendSecureMessage(const char* topic, const uint8_t* data, size_t len) {
-    String secureMessage = prepareSecureMessage(data, len);
-    
-    mqtt.beginMessage(topic);
-    mqtt.print(secureMessage);
-    mqtt.endMessage();
+/**
+ * @brief Collega l'uscita che apre la porta a ogni accesso concesso
+ * @param pin Pin del relè o della serratura
+ * @param pulseMs Durata dell'apertura, rilasciata da update() senza bloccare
+ * @param activeHigh true se il pin apre a livello alto
+ */
+void NFCManager::attachLock(uint8_t pin, uint32_t pulseMs, bool activeHigh) {
+    lock.attach(pin, pulseMs, activeHigh);
 }
 
 /**
@@ -316,63 +351,436 @@ void NFCManager::setAdminMode(bool enabled) {
 /**
  * @brief Inizializza il gestore NFC
  * @return true se l'inizializzazione è avvenuta con successo, false altrimenti
- * @security Reset della cache per evitare dati residui
+ * @details La cache non viene azzerata: è ripristinata da TagCacheStore
  */
 bool NFCManager::begin() {
-    // Reset della cache per evitare dati residui
-    cache = SecureTagCache();
-    if (!nfc.begin()) {
-        return false;
+    bool ok = readerCount > 0;
+    for (uint8_t i = 0; i < readerCount; i++) {
+        if (!readers[i]->begin()) {
+            LOG_ERROR.print("[NFC] Lettore non risponde: ");
+            LOG_ERROR.println((unsigned)i);
+            ok = false;
+        }
     }
-    return true;
+    // ID iniziale casuale: le risposte a richieste precedenti al riavvio non vengono associate
+    verifies.seed((uint16_t)random(1, 0x10000));
+#if EVENT_QUEUE_PERSIST
+    // Eventi non inviati prima del riavvio
+    if (!events.begin()) {
+        LOG_WARN.println("[QUEUE] Area EEPROM insufficiente, coda solo in RAM");
+    }
+#endif
+    return ok;
 }
 
 /**
  * @brief Aggiorna lo stato del gestore NFC e gestisce lettura/verifica dei tag
- * @return true se l'operazione è avvenuta con successo, false altrimenti
+ * @return true se è stato letto almeno un nuovo tag, false altrimenti
+ * @details Non blocca: avvia la ricerca dei tag se non è in corso e ne
+ *          controlla lo stato a ogni passaggio del loop, così MQTT e il
+ *          lavoro in background procedono mentre il PN532 attende i tag.
+ *          Una ricerca restituisce fino a NFC_MAX_TARGETS tag (ad esempio
+ *          due badge avvicinati insieme), gestiti tutti nello stesso passaggio.
+ *
+ *          Con più lettori la ricerca resta avviata su tutti, così le attese
+ *          RF si sovrappongono; a ogni passaggio i lettori sono controllati a
+ *          turno partendo da quello dopo l'ultimo servito e si gestiscono i
+ *          tag di un solo lettore, quindi nessun lettore resta in coda.
+ *
+ *          Un tag rimasto nel campo dalla lettura precedente (entro
+ *          NFC_RETRIGGER_MS) viene ignorato: un tap produce una sola
+ *          decisione e un solo evento anche se il badge resta appoggiato.
+ *
+ *          A ogni passaggio le verifiche remote scadute vengono decise con
+ *          la politica locale e l'uscita della porta viene rilasciata allo
+ *          scadere dell'impulso.
+ */
+bool NFCManager::update() {
+    lock.update(millis());
+    expireVerifications();
+
+    uint8_t count = 0;
+    uint8_t reader = 0;
+    uint32_t readUs = 0;
+    bool found = false;
+    for (uint8_t n = 0; n < readerCount && !found; n++) {
+        reader = (nextReader + n) % readerCount;
+        NFCReader& nfc = *readers[reader];
+        if (!nfc.isReadPending() && !nfc.startRead()) continue;
+        uint32_t readStart = micros();
+        found = nfc.pollTags(tags, &count) == NFC_READ_DONE;
+        readUs = micros() - readStart;
+    }
+    if (!found) return false;
+    nextReader = (reader + 1) % readerCount;
+
+    // Badge tenuti appoggiati: il PN532 li rilegge a ogni ricerca, ma
+    // decisione ed evento spettano solo al primo tap
+    uint8_t fresh = 0;
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t uid[7] = {0};
+        memcpy(uid, tags[i].uid, tags[i].uidLength);
+        if (!presence.arrive(uid, tags[i].uidLength, reader, now)) continue;
+        if (fresh != i) tags[fresh] = tags[i];
+        fresh++;
+    }
+    if (fresh == 0) return false;
+    count = fresh;
+    metrics.record(TAP_STAGE_READ, readUs);
+    currentReader = reader;
+    heap.begin();
+    tapStart = micros();
+    inTap = true;
+
+    if (readerCount > 1) {
+        LOG_DEBUG.print("\n[READ] Lettore: ");
+        LOG_DEBUG.println((unsigned)reader);
+    }
+    if (count > 1) {
+        LOG_DEBUG.print("\n[READ] Tag nel campo: ");
+        LOG_DEBUG.println(count);
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        handleTag(tags[i]);
+    }
+
+    // Un blocco di accessi pieno parte subito, senza attendere la finestra
+    flushAccessLog();
+    inTap = false;
+
+    if (heap.end() != 0) {
+        if (LOG_ENABLED(LOG_LEVEL_WARN)) heap.printStats(Log);
+    }
+    return true;
+}
+
+/**
+ * @brief Verifica un tag letto e notifica il server
  * @details Gestisce:
- *  - Lettura del tag NFC
- *  - Verifica locale nella cache
+ *  - Verifica locale nella cache e apertura immediata della porta
  *  - Invio notifiche MQTT per accessi e verifiche remote
  * @security Implementa:
  *  - Logging sicuro senza esporre dati sensibili
  *  - Comunicazione cifrata con il server
  */
-bool NFCManager::update() {
-    if (!nfc.readPassiveTargetID(0, tempUid, &uidLength)) return false;
-    
-    Serial.print("\n[READ] Tag UID: ");
-    for (uint8_t i = 0; i < uidLength; i++) {
-        if (tempUid[i] < 0x10) Serial.print("0");
-        Serial.print(tempUid[i], HEX);
-        Serial.print(" ");
+void NFCManager::handleTag(const NFCTag& tag) {
+    // UID da 4 byte completati con zeri: la cache confronta sempre 7 byte
+    memset(tempUid, 0, sizeof(tempUid));
+    memcpy(tempUid, tag.uid, tag.uidLength);
+    uidLength = tag.uidLength;
+
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+        Log.print("\n[READ] Tag UID: ");
+        for (uint8_t i = 0; i < uidLength; i++) {
+            if (tempUid[i] < 0x10) Log.print("0");
+            Log.print(tempUid[i], HEX);
+            Log.print(" ");
+        }
+        Log.print("(ATQA: ");
+        Log.print(tag.atqa, HEX);
+        Log.print(", SAK: ");
+        Log.print(tag.sak, HEX);
+        Log.println(")");
     }
-    Serial.println();
     
+    uint32_t cacheStart = micros();
     bool verified = cache.verifyTag(tempUid);
+    uint8_t verdict = VERDICT_NONE;
+    if (!verified) {
+        uint8_t fingerprint[VERDICT_TAG_LEN];
+        verdictTag(tempUid, uidLength, fingerprint);
+        verdict = verdicts.lookup(fingerprint, millis());
+    }
+    metrics.record(TAP_STAGE_CACHE, micros() - cacheStart);
     if (verified){
-        Serial.println("[RESULT] ACCESS GRANTED");
-        // Server registra log di acceso
-        sendSecureMessage("nfc/access",tempUid,uidLength);    
+        // Prima la porta, poi log e messaggi: l'attesa percepita è la sola ricerca in cache
+        actuate(tempUid, uidLength, currentReader, true, DECISION_CACHE);
+        metrics.record(TAP_STAGE_DECISION, micros() - tapStart);
+        LOG_INFO.println("[RESULT] ACCESS GRANTED");
+        logAccess(EVENT_ACCESS);
+    }else if (verdict != VERDICT_NONE){
+        // Il server ha deciso per questo badge da poco: nessuna nuova richiesta
+        bool granted = verdict == VERDICT_GRANTED;
+        actuate(tempUid, uidLength, currentReader, granted, DECISION_VERDICT);
+        metrics.record(TAP_STAGE_DECISION, micros() - tapStart);
+        LOG_INFO.println(granted ? "[RESULT] ACCESS GRANTED (esito memorizzato)"
+                                 : "[RESULT] ACCESS DENIED (esito memorizzato)");
+        logAccess(granted ? EVENT_VERDICT_GRANTED : EVENT_VERDICT_DENIED);
+    }else if (!mqtt.connected()){
+        // Server irraggiungibile: inutile attendere la scadenza
+        bool granted = decideLocally("server non raggiungibile");
+        events.push(granted ? EVENT_OFFLINE_GRANTED : EVENT_OFFLINE_DENIED, tempUid, uidLength, millis() / 1000);
     }else{
-        Serial.println("[RESULT] ACCESS DENIED - SERVER AUTHENTICATION VERIFY");
-        // Server gestisce autenticazione
-        sendSecureMessage("nfc/verify",tempUid,uidLength);    
+        // Server gestisce autenticazione: la decisione arriva con la risposta
+        requestVerify();
+    }
+}
+
+/**
+ * @brief Registra l'evento del tag corrente deciso in locale
+ * @param type EVENT_ACCESS, EVENT_VERDICT_GRANTED o EVENT_VERDICT_DENIED
+ * @details Un messaggio ogni ACCESS_BATCH_MAX eventi o ACCESS_BATCH_WINDOW_MS;
+ *          offline l'evento attende la riconnessione nella coda
+ */
+void NFCManager::logAccess(uint8_t type) {
+    if (!mqtt.connected()) {
+        events.push(type, tempUid, uidLength, millis() / 1000);
+        return;
     }
+    if (!accessLog.add(type, tempUid, uidLength, millis())) {
+        flushAccessLog();
+        accessLog.add(type, tempUid, uidLength, millis());
+    }
+}
 
-    return true;
+/**
+ * @brief Impronta di un UID per la cache degli esiti
+ * @param uid UID (7 byte, completato con zeri)
+ * @param length Byte significativi dell'UID
+ * @param tag Riceve VERDICT_TAG_LEN byte
+ * @security MAC con la chiave del dispositivo: la tabella non contiene
+ *           UID in chiaro
+ */
+void NFCManager::verdictTag(const uint8_t* uid, uint8_t length, uint8_t* tag) {
+    uint8_t data[8];
+    data[0] = length;
+    memcpy(data + 1, uid, 7);
+    crypto.generateMAC(data, sizeof(data), tag);
+}
+
+/**
+ * @brief Verifica la firma di una risposta a nfc/verify
+ * @param request Richiesta a cui si riferisce la risposta
+ * @param granted Esito riportato nel testo
+ * @param ttl Validità dell'esito in secondi riportata nel testo
+ * @param sig 16 cifre esadecimali dopo " sig="
+ * @return true se il MAC corrisponde
+ * @security Il MAC copre esito, ID, validità e UID della richiesta: una
+ *           risposta alterata o destinata a un altro tag viene scartata
+ */
+bool NFCManager::responseSigned(const PendingVerify& request, bool granted, uint32_t ttl, const char* sig) {
+    uint8_t data[15];
+    data[0] = VERIFY_RESPONSE_TAG;
+    data[1] = granted ? 1 : 0;
+    data[2] = request.id & 0xFF;
+    data[3] = request.id >> 8;
+    for (uint8_t i = 0; i < 4; i++) data[4 + i] = (uint8_t)(ttl >> (8 * i));
+    memcpy(data + 8, request.uid, 7);
+
+    uint8_t mac[8];
+    crypto.generateMAC(data, sizeof(data), mac);
+
+    uint8_t diff = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        uint8_t b = 0;
+        for (uint8_t n = 0; n < 2; n++) {
+            char c = sig[2 * i + n];
+            uint8_t v;
+            if (c >= '0' && c <= '9') v = c - '0';
+            else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+            else return false;
+            b = (b << 4) | v;
+        }
+        diff |= b ^ mac[i];
+    }
+    return diff == 0;
+}
+
+/**
+ * @brief Invia il tag corrente al server senza attendere la risposta
+ * @details La richiesta entra nella tabella delle verifiche in corso con
+ *          un ID e una scadenza; handleResponse() o expireVerifications()
+ *          la concludono. Intanto il loop continua a leggere altri tag.
+ *          A tabella piena il tap viene deciso subito con la politica locale.
+ */
+void NFCManager::requestVerify() {
+    uint32_t now = millis();
+    uint16_t id = verifies.add(tempUid, uidLength, currentReader, now, verifyTimeout);
+    if (id == 0) {
+        decideLocally("troppe verifiche in corso");
+        return;
+    }
+
+    LOG_DEBUG.print("[VERIFY] Richiesta ");
+    LOG_DEBUG.print((unsigned)id);
+    LOG_DEBUG.println(" inviata al server");
+    // Una richiesta non inviata scade e viene decisa dalla politica locale
+    sendSecureMessage("nfc/verify", tempUid, uidLength, id);
+}
+
+/**
+ * @brief Decide subito il tag corrente con la politica locale
+ * @param reason Motivo stampato con l'esito
+ * @return Esito della politica locale
+ */
+bool NFCManager::decideLocally(const char* reason) {
+    PendingVerify request;
+    memset(&request, 0, sizeof(request));
+    request.sentAt = millis();
+    memcpy(request.uid, tempUid, sizeof(request.uid));
+    request.uidLength = uidLength;
+    request.reader = currentReader;
+
+    bool granted = verifyFallback == VERIFY_FALLBACK_GRANT;
+    reportDecision(request, granted, reason);
+    return granted;
+}
+
+/**
+ * @brief Decide con la politica locale le verifiche senza risposta in tempo
+ */
+void NFCManager::expireVerifications() {
+    PendingVerify request;
+    bool expired = false;
+    while (verifies.expire(millis(), request)) {
+        reportDecision(request, verifyFallback == VERIFY_FALLBACK_GRANT, "timeout");
+        expired = true;
+    }
+    if (expired && LOG_ENABLED(LOG_LEVEL_WARN)) verifies.printStats(Log);
+}
+
+/**
+ * @brief Associa una risposta del server alla verifica in corso
+ * @param topic Topic del messaggio
+ * @param payload Testo della risposta, terminato da zero
+ * @details Le risposte di verifica terminano con " id=<ID>". Un errore con
+ *          ID conclude la richiesta con la politica locale senza attendere
+ *          la scadenza. Gli altri messaggi (log) sono ignorati.
+ *
+ *          Un esito con firma valida viene memorizzato per il ttl indicato
+ *          dal server (al più VERDICT_TTL_MAX_MS); una firma errata scarta
+ *          la risposta e la richiesta viene decisa alla scadenza.
+ * @security Con VERIFY_REQUIRE_SIGNATURE (predefinito) solo un esito firmato
+ *           apre la porta. Un errore senza firma non concede più della
+ *           scadenza che anticipa. Le risposte senza firma o senza ID
+ *           (server precedenti) sono accettate solo con
+ *           VERIFY_REQUIRE_SIGNATURE 0: quelle senza ID concludono la
+ *           richiesta più vecchia.
+ */
+void NFCManager::handleResponse(const char* topic, const char* payload) {
+    if (strcmp(topic, "nfc/response") != 0) return;
+
+    bool granted = strstr(payload, "ACCESS GRANTED") != nullptr;
+    bool denied = strstr(payload, "ACCESS DENIED") != nullptr;
+    const char* idField = strstr(payload, " id=");
+    uint16_t id = idField ? (uint16_t)strtoul(idField + 4, nullptr, 10) : 0;
+    bool error = strncmp(payload, "[ERROR]", 7) == 0 && id != 0;
+    if (!granted && !denied && !error) return;
+
+    // Esito firmato: " ttl=<secondi> sig=<MAC>" dopo l'ID
+    const char* ttlField = strstr(payload, " ttl=");
+    const char* sigField = strstr(payload, " sig=");
+    uint32_t ttl = ttlField ? strtoul(ttlField + 5, nullptr, 10) : 0;
+    bool signedVerdict = false;
+    if (!error && ttlField && sigField && strlen(sigField + 5) >= 16) {
+        const PendingVerify* pending = verifies.find(id);
+        if (pending) {
+            signedVerdict = responseSigned(*pending, granted, ttl, sigField + 5);
+            if (!signedVerdict) {
+                LOG_WARN.println("[SECURITY] Firma della risposta non valida");
+                return;
+            }
+        }
+    }
+#if VERIFY_REQUIRE_SIGNATURE
+    // Un esito firmato o un errore hanno sempre un ID: take(0) resta ai server precedenti
+    if (!error && !signedVerdict) {
+        LOG_WARN.println("[SECURITY] Risposta senza firma ignorata");
+        return;
+    }
+#endif
+
+    PendingVerify request;
+    if (!verifies.take(id, millis(), request)) {
+        LOG_WARN.println("[VERIFY] Risposta senza richiesta in attesa");
+        return;
+    }
+    metrics.record(TAP_STAGE_SERVER, verifies.stats().rttLast * 1000UL);
+    if (error) {
+        reportDecision(request, verifyFallback == VERIFY_FALLBACK_GRANT, "errore del server");
+        return;
+    }
+    reportDecision(request, granted, nullptr);
+
+    // I tap successivi dello stesso badge sono decisi in locale fino alla scadenza
+    if (signedVerdict) {
+        uint8_t fingerprint[VERDICT_TAG_LEN];
+        verdictTag(request.uid, request.uidLength, fingerprint);
+        uint32_t ttlMs = ttl >= VERDICT_TTL_MAX_MS / 1000 ? VERDICT_TTL_MAX_MS : ttl * 1000UL;
+        verdicts.store(fingerprint, granted ? VERDICT_GRANTED : VERDICT_DENIED, millis(), ttlMs);
+    }
+}
+
+/**
+ * @brief Applica e stampa l'esito di una verifica remota
+ * @param request Richiesta conclusa
+ * @param granted Esito
+ * @param reason nullptr per una decisione del server, altrimenti il motivo
+ *        per cui si è applicata la politica locale
+ */
+void NFCManager::reportDecision(const PendingVerify& request, bool granted, const char* reason) {
+    actuate(request.uid, request.uidLength, request.reader, granted,
+            reason ? DECISION_FALLBACK : DECISION_SERVER);
+    if (!LOG_ENABLED(LOG_LEVEL_INFO)) return;
+    Log.print(granted ? "[RESULT] ACCESS GRANTED" : "[RESULT] ACCESS DENIED");
+    Log.print(" - UID: ");
+    for (uint8_t i = 0; i < request.uidLength; i++) {
+        if (request.uid[i] < 0x10) Log.print("0");
+        Log.print(request.uid[i], HEX);
+    }
+    if (reason) {
+        Log.print(" (politica locale: ");
+        Log.print(reason);
+        Log.println(")");
+    } else {
+        Log.print(" (server, ");
+        Log.print((unsigned long)verifies.stats().rttLast);
+        Log.println(" ms)");
+    }
+}
+
+/**
+ * @brief Esegue una decisione di accesso
+ * @details Apre la porta se l'accesso è concesso e chiama il gestore
+ *          registrato con setDecisionHandler(). Viene chiamata prima di
+ *          stampe e messaggi MQTT, che seguono la decisione senza ritardarla.
+ */
+void NFCManager::actuate(const uint8_t* uid, uint8_t length, uint8_t reader, bool granted, DecisionSource source) {
+    if (granted) lock.open(millis());
+    if (!decisionHandler) return;
+
+    AccessDecision decision;
+    decision.uid = uid;
+    decision.uidLength = length;
+    decision.reader = reader;
+    decision.granted = granted;
+    decision.source = source;
+    decisionHandler(decision);
+}
+
+/**
+ * @brief Stampa modalità e traffico di controllo di ogni lettore
+ */
+void NFCManager::printReaderStats(Print& out) const {
+    for (uint8_t i = 0; i < readerCount; i++) {
+        readers[i]->printStats(out, i);
+    }
 }
 
 /**
  * @brief Registra un nuovo tag nel sistema
  * @return true se la registrazione è avvenuta con successo, false altrimenti
+ * @details Legge dal primo lettore
  * @security Implementa:
  *  - Verifica dei permessi amministratore
  *  - Cifratura dei dati del tag
  *  - Notifica sicura al server
  */
 bool NFCManager::registerNewTag() {
-    if (!isAdmin || !nfc.readPassiveTargetID(0, tempUid, &uidLength))
+    if (!isAdmin) return false;
+    memset(tempUid, 0, sizeof(tempUid));
+    if (!readers[0]->readPassiveTargetID(0, tempUid, &uidLength))
         return false;
     if (cache.addTag(tempUid)) {
         // Possibile gestione in locale su arduino dei tag pre-registrati
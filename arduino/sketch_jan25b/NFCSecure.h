@@ -5,61 +5,220 @@
 #include <EEPROM.h>
 #include <ArduinoMqttClient.h>
 #include "LightweightCrypto.h"
+#include "SecureTagCache.h"
+#include "KeystreamPool.h"
+#include "HeapMonitor.h"
+#include "VerifyTracker.h"
+#include "EventQueue.h"
+#include "AccessLogBatcher.h"
+#include "TapMetrics.h"
+#include "DoorLock.h"
+#include "PresenceTracker.h"
+#include "VerdictCache.h"
+#include "Log.h"
 #include "PN532.h"
 
-// SECURITY: Strutture dati con packed attribute per minimizzare memoria
-struct TagEntry {
-    uint8_t uid[7];        // UID del tag NFC
-    uint32_t lastUsed;     // Timestamp ultimo utilizzo
-    uint16_t useCount;     // Contatore utilizzi
-    bool valid;            // Flag validità
-} __attribute__((packed));
-
-struct EncryptedData {
-    uint8_t iv[8];         // Vettore di inizializzazione
-    uint8_t data[32];      // Dati cifrati
-    uint8_t mac[8];        // MAC per integrità
-} __attribute__((packed));
-
-class SecureTagCache {
-private:
-    static constexpr uint16_t EEPROM_MAGIC = 0xABCD;
-    static const uint8_t MAX_TAGS = 5;
-    LightweightCrypto crypto;
-    EncryptedData cache[MAX_TAGS];
-    uint8_t numTags;
+// Dati massimi per messaggio: UID, MAC del dispositivo, API key (32 caratteri),
+// blocchi di eventi su nfc/batch (6 eventi da 13 byte)
+#ifndef SECURE_MESSAGE_MAX_DATA
+#define SECURE_MESSAGE_MAX_DATA 80
+#endif
 
-public:
-    SecureTagCache();
-    bool addTag(const uint8_t* uid);
-    bool verifyTag(const uint8_t* uid);
-    bool saveToEEPROM();
-    bool loadFromEEPROM();
-};
+// Primo byte del frame binario: non è mai una cifra esadecimale, quindi il
+// broker distingue il frame dai messaggi in testo
+#define SECURE_FRAME_VERSION 0x02
+// Frame con ID della richiesta: versione || flags || ID (2 byte LE) || IV || ciphertext || MAC
+#define SECURE_FRAME_VERSION_ID 0x03
+
+// Dati allineati al blocco TEA
+#define SECURE_PADDED_LEN(len) ((((size_t)(len)) + 7) & ~(size_t)7)
+// Byte del frame binario (versione || flags || IV || ciphertext || MAC) per len byte di dati
+#define SECURE_FRAME_LEN(len) (2 + 8 + SECURE_PADDED_LEN(len) + 8)
+// Byte del frame binario con ID della richiesta
+#define SECURE_FRAME_ID_LEN(len) (SECURE_FRAME_LEN(len) + 2)
+// Caratteri del messaggio esadecimale (header || IV || ciphertext || MAC), terminatore escluso
+#define SECURE_MESSAGE_LEN(len) (2 * (1 + 8 + SECURE_PADDED_LEN(len) + 8))
+
+// Keystream CTR tenuti pronti: voci e blocchi da 8 byte per voce (un UID occupa un blocco)
+#ifndef KEYSTREAM_POOL_DEPTH
+#define KEYSTREAM_POOL_DEPTH 4
+#endif
+#ifndef KEYSTREAM_POOL_BLOCKS
+#define KEYSTREAM_POOL_BLOCKS 2
+#endif
+
+typedef KeystreamPool<KEYSTREAM_POOL_DEPTH, KEYSTREAM_POOL_BLOCKS> NFCKeystreamPool;
+
+// Verifiche remote in corso contemporaneamente (tap di tag diversi)
+#ifndef VERIFY_MAX_PENDING
+#define VERIFY_MAX_PENDING 4
+#endif
+// Attesa massima della risposta a nfc/verify (ms)
+#ifndef VERIFY_TIMEOUT_MS
+#define VERIFY_TIMEOUT_MS 2000
+#endif
+
+// Decisione locale se il server non risponde in tempo o segnala un errore
+#define VERIFY_FALLBACK_DENY 0
+#define VERIFY_FALLBACK_GRANT 1
+#ifndef VERIFY_FALLBACK
+#define VERIFY_FALLBACK VERIFY_FALLBACK_DENY
+#endif
+
+typedef VerifyTracker<VERIFY_MAX_PENDING> NFCVerifyTracker;
+
+// Esiti firmati del server tenuti in RAM per i tap successivi dello stesso badge
+#ifndef VERDICT_CACHE_SIZE
+#define VERDICT_CACHE_SIZE 8
+#endif
+// Validità massima di un esito memorizzato, qualunque sia il ttl del server (ms)
+#ifndef VERDICT_TTL_MAX_MS
+#define VERDICT_TTL_MAX_MS 3600000UL
+#endif
+// 1: le risposte senza firma valida sono ignorate (la richiesta scade);
+// 0: solo per server precedenti o messaggi hex, sono accettate per la
+// decisione ma non memorizzate e quelle senza ID concludono la richiesta
+// più vecchia. Nessuno autentica chi pubblica su nfc/response: con 0
+// chiunque raggiunga il broker può aprire la porta
+#ifndef VERIFY_REQUIRE_SIGNATURE
+#define VERIFY_REQUIRE_SIGNATURE 1
+#endif
+// Primo byte dei dati firmati: tipo || esito || ID (2 LE) || ttl in secondi (4 LE) || UID (7)
+#define VERIFY_RESPONSE_TAG 'R'
+
+typedef VerdictCache<VERDICT_CACHE_SIZE> NFCVerdictCache;
+
+// Eventi conservati mentre il broker non è raggiungibile
+#ifndef EVENT_QUEUE_CAPACITY
+#define EVENT_QUEUE_CAPACITY 32
+#endif
+// Copia della coda in EEPROM (1) o solo in RAM (0)
+#ifndef EVENT_QUEUE_PERSIST
+#define EVENT_QUEUE_PERSIST 1
+#endif
+// Intervallo minimo tra due messaggi su nfc/batch (ms)
+#ifndef EVENT_FLUSH_INTERVAL_MS
+#define EVENT_FLUSH_INTERVAL_MS 250
+#endif
+// Eventi per messaggio: numero di eventi (1 byte) seguito dai record
+#define EVENT_BATCH_MAX ((SECURE_MESSAGE_MAX_DATA - 1) / EVENT_RECORD_LEN)
+
+// Accessi concessi raggruppati in un messaggio: al più ACCESS_BATCH_MAX eventi
+// o ACCESS_BATCH_WINDOW_MS dal primo, quale delle due arriva prima
+#ifndef ACCESS_BATCH_MAX
+#define ACCESS_BATCH_MAX EVENT_BATCH_MAX
+#endif
+#ifndef ACCESS_BATCH_WINDOW_MS
+#define ACCESS_BATCH_WINDOW_MS 2000
+#endif
+
+// Intervallo di pubblicazione degli istogrammi su nfc/metrics (ms), 0 per non pubblicarli
+#ifndef TAP_METRICS_INTERVAL_MS
+#define TAP_METRICS_INTERVAL_MS 60000
+#endif
+
+// Tag seguiti per riconoscere un badge tenuto appoggiato al lettore
+#ifndef PRESENCE_MAX_TAGS
+#define PRESENCE_MAX_TAGS 4
+#endif
+// Assenza dopo la quale lo stesso UID sullo stesso lettore è un nuovo tap (ms)
+#ifndef NFC_RETRIGGER_MS
+#define NFC_RETRIGGER_MS 1000
+#endif
+
+typedef PresenceTracker<PRESENCE_MAX_TAGS> NFCPresenceTracker;
+
+// Durata predefinita dell'apertura della porta (ms)
+#ifndef DOOR_LOCK_PULSE_MS
+#define DOOR_LOCK_PULSE_MS 3000
+#endif
+
+typedef EventQueue<EVENT_QUEUE_CAPACITY> NFCEventQueue;
+typedef AccessLogBatcher<ACCESS_BATCH_MAX> NFCAccessLog;
+static_assert(ACCESS_BATCH_MAX <= EVENT_BATCH_MAX, "Blocco di accessi oltre SECURE_MESSAGE_MAX_DATA");
 
 class NFCManager {
 private:
-    NFCReader& nfc;
+    NFCReader* singleReader;        // Lettore del costruttore a lettore singolo
+    NFCReader* const* readers;      // Lettori serviti a turno da update()
+    uint8_t readerCount;
+    uint8_t nextReader;             // Primo lettore controllato al prossimo passaggio
     SecureTagCache& cache;
     MqttClient& mqtt;
     LightweightCrypto crypto;
+    NFCKeystreamPool keystreamPool;
+    uint8_t cipherMode;     // SECURE_MODE_CTR (predefinita) o SECURE_MODE_ECB
+    bool binaryFrames;      // true: nfc/access e nfc/verify come frame binario
+    HeapMonitor heap;       // Heap usato durante la lettura di un tag
+    NFCVerifyTracker verifies;  // Richieste su nfc/verify in attesa di risposta
+    uint32_t verifyTimeout;     // Scadenza di ogni richiesta (ms)
+    uint8_t verifyFallback;     // VERIFY_FALLBACK_DENY o VERIFY_FALLBACK_GRANT
+    NFCEventQueue events;       // Eventi da inviare alla riconnessione
+    uint32_t lastFlush;         // millis() dell'ultimo invio su nfc/batch
+    NFCAccessLog accessLog;     // Accessi concessi in attesa di essere inviati insieme
+    TapMetrics metrics;         // Durata delle fasi di ogni lettura
+    uint32_t lastMetrics;       // millis() dell'ultima pubblicazione su nfc/metrics
+    uint32_t tapStart;          // micros() alla lettura dei tag in corso
+    bool inTap;                 // true durante la gestione dei tag letti
+    uint8_t currentReader;      // Lettore dei tag in corso di gestione
+    DoorLock lock;              // Uscita aperta a ogni accesso concesso
+    AccessDecisionHandler decisionHandler;  // Gestore chiamato a ogni decisione
+    NFCPresenceTracker presence;    // Tag rimasti nel campo dopo la lettura
+    NFCVerdictCache verdicts;       // Esiti recenti del server per i tag non in cache
     bool isAdmin;
     uint8_t tempUid[7];
     uint8_t uidLength;
+    NFCTag tags[NFC_MAX_TARGETS];   // Tag dell'ultima ricerca
     uint8_t rounds;
     uint8_t key[16]; 
 
+    void handleTag(const NFCTag& tag);
+    size_t sealSecureFrame(const uint8_t* data, size_t len, uint8_t* out, size_t prefixLen);
+    void requestVerify();
+    bool decideLocally(const char* reason);
+    void flushEvents();
+    void flushAccessLog();
+    void publishMetrics();
+    void expireVerifications();
+    void reportDecision(const PendingVerify& request, bool granted, const char* reason);
+    void logAccess(uint8_t type);
+    void verdictTag(const uint8_t* uid, uint8_t length, uint8_t* tag);
+    bool responseSigned(const PendingVerify& request, bool granted, uint32_t ttl, const char* sig);
+    void actuate(const uint8_t* uid, uint8_t length, uint8_t reader, bool granted, DecisionSource source);
 
 
 public:
     NFCManager(NFCReader& nfcReader, SecureTagCache& tagCache, MqttClient& mqttClient);
+    NFCManager(NFCReader* const* nfcReaders, uint8_t count, SecureTagCache& tagCache, MqttClient& mqttClient);
     void setAdminMode(bool enabled);
     bool update();
     bool begin();
     bool registerNewTag();
+    void idle();
+    void setCipherMode(uint8_t mode);
+    void setBinaryFrames(bool enabled);
+    void setVerifyTimeout(uint32_t timeoutMs);
+    void setVerifyFallback(uint8_t policy);
+    void handleResponse(const char* topic, const char* payload);
+    const NFCKeystreamPool& keystream() const { return keystreamPool; }
+    const HeapMonitor& heapMonitor() const { return heap; }
+    const NFCVerifyTracker& verifications() const { return verifies; }
+    const NFCEventQueue& eventQueue() const { return events; }
+    const NFCAccessLog& accessLogBatcher() const { return accessLog; }
+    const TapMetrics& tapMetrics() const { return metrics; }
+    void setAccessBatchWindow(uint32_t windowMs) { accessLog.setWindow(windowMs); }
+    void setDecisionHandler(AccessDecisionHandler handler) { decisionHandler = handler; }
+    void attachLock(uint8_t pin, uint32_t pulseMs = DOOR_LOCK_PULSE_MS, bool activeHigh = true);
+    const DoorLock& doorLock() const { return lock; }
+    const NFCPresenceTracker& presenceTracker() const { return presence; }
+    const NFCVerdictCache& verdictCache() const { return verdicts; }
+    void setRetriggerWindow(uint32_t windowMs) { presence.setWindow(windowMs); }
+    void printReaderStats(Print& out) const;
 
     
-    void sendSecureMessage(const char* topic, const uint8_t* data, size_t len);
+    bool sendSecureMessage(const char* topic, const uint8_t* data, size_t len, uint16_t requestId = 0);
+    size_t prepareSecureFrame(const uint8_t* data, size_t len, uint8_t* out, size_t outSize, uint16_t requestId = 0);
+    size_t prepareSecureMessage(const uint8_t* data, size_t len, char* out, size_t outSize);
     String prepareSecureMessage(const uint8_t* data, size_t len);
 
 };
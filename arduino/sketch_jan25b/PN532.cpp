@@ -1,16 +1,32 @@
 #include "PN532.h"
 #include <SPI.h>
+#include <Wire.h>
 #include <PN532_SPI.h>
+#include <PN532_I2C.h>
 #include <PN532.h>
 
-NFCReader::NFCReader() {
-    pn532spi = new PN532_SPI(SPI, PN532_SS);
-    nfc = new PN532(*pn532spi);
+/**
+ * @brief Lettore PN532 sul bus SPI
+ * @param ss Chip select: più lettori condividono il bus con pin diversi
+ * @param irq Pin IRQ del modulo, 0xFF per leggere lo stato via SPI
+ */
+NFCReader::NFCReader(uint8_t ss, uint8_t irq) : pending(false), targetType(PN532_AUTOPOLL_GENERIC_106) {
+    bus = new PN532_SPI(SPI, ss, irq);
+    nfc = new PN532(*bus);
+}
+
+/**
+ * @brief Lettore PN532 sul bus I2C
+ * @details Il PN532 ha un indirizzo I2C fisso: un solo lettore per bus
+ */
+NFCReader::NFCReader(TwoWire& wire, uint8_t irq) : pending(false), targetType(PN532_AUTOPOLL_GENERIC_106) {
+    bus = new PN532_I2C(wire, irq);
+    nfc = new PN532(*bus);
 }
 
 NFCReader::~NFCReader() {
     delete nfc;
-    delete pn532spi;
+    delete bus;
 }
 
 bool NFCReader::begin() {
@@ -20,9 +36,143 @@ bool NFCReader::begin() {
         return false;
     }
     nfc->SAMConfig();
+    pending = false;
     return true;
 }
 
+/**
+ * @brief Legge l'UID di un tag attendendo al massimo NFC_READ_TIMEOUT_MS
+ * @details Versione bloccante di startRead()/pollRead(): allo scadere
+ *          dell'attesa la lettura resta avviata e pollRead() la completa
+ */
 bool NFCReader::readPassiveTargetID(uint8_t cardBaudRate, uint8_t* uid, uint8_t* uidLength) {
-    return nfc->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, uidLength);
-}
\ No newline at end of file
+    if (!pending && !startRead()) return false;
+
+    unsigned long start = millis();
+    NFCReadStatus status;
+    while ((status = pollRead(uid, uidLength)) == NFC_READ_PENDING) {
+        if (millis() - start >= NFC_READ_TIMEOUT_MS) return false;
+        delay(1);
+    }
+    return status == NFC_READ_DONE;
+}
+
+/**
+ * @brief Avvia la ricerca dei tag ISO14443A senza attenderli
+ * @return true se il PN532 ha accettato il comando
+ * @details Costa solo l'invio del comando e l'ACK (circa 1 ms); il PN532
+ *          continua a cercare finché pollTags() non legge i tag trovati,
+ *          fino a NFC_MAX_TARGETS in una sola ricerca. Con
+ *          NFC_AUTOPOLL_PERIOD usa InAutoPoll: il PN532 alterna la ricerca
+ *          a pause di N x 150 ms e risponde solo quando trova un tag
+ */
+bool NFCReader::startRead() {
+#if NFC_AUTOPOLL_PERIOD
+    static const uint8_t types[] = { PN532_AUTOPOLL_MIFARE, PN532_AUTOPOLL_ISO14443_4A };
+    pending = nfc->startAutoPoll(types, sizeof(types), NFC_AUTOPOLL_PERIOD, PN532_AUTOPOLL_ENDLESS);
+#else
+    pending = nfc->startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A, NFC_MAX_TARGETS);
+#endif
+    return pending;
+}
+
+/**
+ * @brief Controlla senza attendere se la lettura avviata è completa
+ * @param uid Riceve l'UID (fino a 7 byte) del primo tag se lo stato è NFC_READ_DONE
+ * @param uidLength Riceve la lunghezza dell'UID
+ * @return Stato della lettura, come pollTags()
+ */
+NFCReadStatus NFCReader::pollRead(uint8_t* uid, uint8_t* uidLength) {
+    NFCTag tags[NFC_MAX_TARGETS];
+    uint8_t count;
+    NFCReadStatus status = pollTags(tags, &count);
+    if (status == NFC_READ_DONE) {
+        memcpy(uid, tags[0].uid, tags[0].uidLength);
+        *uidLength = tags[0].uidLength;
+    }
+    return status;
+}
+
+/**
+ * @brief Controlla senza attendere se la lettura avviata è completa
+ * @param tags Array di NFC_MAX_TARGETS elementi, riceve i tag trovati
+ * @param count Riceve il numero di tag (almeno 1 se lo stato è NFC_READ_DONE)
+ * @return Stato della lettura; dopo NFC_READ_DONE o NFC_READ_ERROR va
+ *         chiamata di nuovo startRead()
+ * @details Finché non c'è un tag costa la lettura di un byte di stato dal PN532
+ */
+NFCReadStatus NFCReader::pollTags(NFCTag* tags, uint8_t* count) {
+    if (!pending) return NFC_READ_IDLE;
+    if (!nfc->isReady()) return NFC_READ_PENDING;
+
+    pending = false;
+#if NFC_AUTOPOLL_PERIOD
+    *count = readAutoPollTag(tags);
+#else
+    *count = readListedTags(tags);
+#endif
+    return *count > 0 ? NFC_READ_DONE : NFC_READ_ERROR;
+}
+
+/**
+ * @brief Copia un tag nel formato del gestore
+ * @return false per UID oltre NFC_UID_MAX_LENGTH (triple size)
+ */
+static bool copyTag(NFCTag& tag, uint16_t atqa, uint8_t sak, const uint8_t* uid, uint8_t uidLength) {
+    if (uidLength == 0 || uidLength > NFC_UID_MAX_LENGTH) return false;
+    tag.atqa = atqa;
+    tag.sak = sak;
+    tag.uidLength = uidLength;
+    memcpy(tag.uid, uid, uidLength);
+    return true;
+}
+
+/**
+ * @brief Legge i tag della risposta di InListPassiveTarget
+ * @return Tag validi letti, 0 in caso di errore
+ */
+uint8_t NFCReader::readListedTags(NFCTag* tags) {
+    PN532_TargetA targets[NFC_MAX_TARGETS];
+    int8_t found = nfc->readDetectedPassiveTargets(targets, NFC_MAX_TARGETS);
+
+    uint8_t count = 0;
+    for (int8_t i = 0; i < found; i++) {
+        const PN532_TargetA& t = targets[i];
+        if (copyTag(tags[count], t.atqa, t.sak, t.uid, t.uidLength)) count++;
+    }
+    targetType = PN532_AUTOPOLL_GENERIC_106;
+    return count;
+}
+
+/**
+ * @brief Legge il primo tag della risposta di InAutoPoll
+ * @return 1 se il tag è valido, 0 altrimenti
+ * @details I dati di un tag di tipo A sono Tg, ATQA (2), SAK, lunghezza e
+ *          UID, seguiti dall'ATS per ISO14443-4
+ */
+uint8_t NFCReader::readAutoPollTag(NFCTag* tags) {
+    uint8_t data[32];
+    uint8_t length = sizeof(data);
+    if (nfc->readAutoPollResult(&targetType, data, &length) <= 0) return 0;
+
+    if (length < 5 || 5 + data[4] > length) return 0;
+    uint16_t atqa = (uint16_t)data[1] << 8 | data[2];
+    return copyTag(tags[0], atqa, data[3], data + 5, data[4]) ? 1 : 0;
+}
+
+/**
+ * @brief Stampa la modalità di attesa del PN532 e il traffico di controllo sul bus
+ * @param index Numero del lettore nel gestore
+ * @details Con il pin IRQ le letture di stato restano a zero e il numero di
+ *          interrupt conta i frame (ACK e risposte) segnalati dal PN532
+ */
+void NFCReader::printStats(Print& out, uint8_t index) const {
+    out.print("[NFC] Lettore ");
+    out.print((unsigned)index);
+    out.print(" - modalita': ");
+    out.print(bus->irqMode() ? "IRQ" : "polling");
+    out.print(", letture di stato: ");
+    out.print((unsigned long)bus->statusReads());
+    out.print(", interrupt: ");
+    out.println((unsigned long)bus->irqEvents());
+}
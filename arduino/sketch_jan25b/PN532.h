@@ -3,20 +3,81 @@
 
 #include <Arduino.h>  // Per uint8_t
 
-class PN532_SPI;  // Forward declaration
-class PN532;      // Forward declaration
+class PN532Interface;  // Forward declaration
+class PN532;           // Forward declaration
+class TwoWire;         // Forward declaration
+
+// Chip select del lettore SPI predefinito
+#ifndef NFC_SS_PIN
+#define NFC_SS_PIN 10
+#endif
+
+// Pin IRQ del PN532 (0xFF = nessuno, si legge lo stato via SPI)
+#ifndef NFC_IRQ_PIN
+#define NFC_IRQ_PIN 0xFF
+#endif
+
+// Ricerca dei tag: 0 = InListPassiveTarget inviato dall'host (latenza minima),
+// 1-15 = InAutoPoll con un ciclo ogni N x 150 ms gestito dal PN532
+#ifndef NFC_AUTOPOLL_PERIOD
+#define NFC_AUTOPOLL_PERIOD 0
+#endif
+
+// Tag letti in una sola ricerca: 1 o 2 (limite di InListPassiveTarget)
+#ifndef NFC_MAX_TARGETS
+#define NFC_MAX_TARGETS 2
+#endif
+
+// Lunghezza massima dell'UID gestita (single e double size)
+#define NFC_UID_MAX_LENGTH 7
+
+// Attesa massima della lettura bloccante (ms)
+#ifndef NFC_READ_TIMEOUT_MS
+#define NFC_READ_TIMEOUT_MS 1000
+#endif
+
+// Stato di una lettura asincrona
+enum NFCReadStatus : uint8_t {
+    NFC_READ_IDLE,      // Nessuna lettura avviata
+    NFC_READ_PENDING,   // Comando inviato, nessun tag nel campo
+    NFC_READ_DONE,      // UID disponibile
+    NFC_READ_ERROR      // Risposta non valida: la lettura va riavviata
+};
+
+// Tag ISO14443A rilevato nel campo
+struct NFCTag {
+    uint16_t atqa;      // SENS_RES
+    uint8_t sak;        // SEL_RES
+    uint8_t uidLength;
+    uint8_t uid[NFC_UID_MAX_LENGTH];
+};
 
 class NFCReader {
 private:
-    PN532_SPI* pn532spi;
+    static_assert(NFC_MAX_TARGETS >= 1 && NFC_MAX_TARGETS <= 2, "NFC_MAX_TARGETS deve essere 1 o 2");
+
+    PN532Interface* bus;
     PN532* nfc;
-    static const uint8_t PN532_SS = 10;
+    bool pending;       // Ricerca avviata e non ancora letta
+    uint8_t targetType; // Tipo dell'ultimo tag letto (PN532_AUTOPOLL_*)
+
+    uint8_t readAutoPollTag(NFCTag* tags);
+    uint8_t readListedTags(NFCTag* tags);
     
 public:
-    NFCReader();
+    explicit NFCReader(uint8_t ss = NFC_SS_PIN, uint8_t irq = NFC_IRQ_PIN);
+    explicit NFCReader(TwoWire& wire, uint8_t irq = NFC_IRQ_PIN);
     ~NFCReader();
+    NFCReader(const NFCReader&) = delete;
+    NFCReader& operator=(const NFCReader&) = delete;
     bool begin();
     bool readPassiveTargetID(uint8_t cardBaudRate, uint8_t* uid, uint8_t* uidLength);
+    bool startRead();
+    NFCReadStatus pollRead(uint8_t* uid, uint8_t* uidLength);
+    NFCReadStatus pollTags(NFCTag* tags, uint8_t* count);
+    bool isReadPending() const { return pending; }
+    uint8_t lastTargetType() const { return targetType; }
+    void printStats(Print& out, uint8_t index = 0) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef PRESENCE_TRACKER_H
+#define PRESENCE_TRACKER_H
+
+#include <Arduino.h>
+
+// Tag nel campo di un lettore
+struct PresentTag {
+    uint8_t uid[7];
+    uint8_t uidLength;    // 0 = voce libera
+    uint8_t reader;
+    uint32_t lastSeen;    // millis() dell'ultima lettura
+};
+
+/**
+ * @brief Riconosce un tag tenuto appoggiato al lettore
+ * @tparam Capacity Tag seguiti contemporaneamente (su tutti i lettori)
+ * @details Finché un badge resta nel campo il PN532 lo rilegge a ogni
+ *          ricerca. Ogni lettura aggiorna l'istante in cui il tag è stato
+ *          visto: se la lettura precedente dello stesso UID sullo stesso
+ *          lettore è più recente della finestra il tag non è mai uscito dal
+ *          campo e la lettura viene ignorata. La rimozione non costa comandi
+ *          al PN532: è l'assenza di letture per la durata della finestra.
+ *          A tabella piena si libera il tag visto meno di recente.
+ */
+template <uint8_t Capacity>
+class PresenceTracker {
+private:
+    static_assert(Capacity > 0, "Dimensione della tabella non valida");
+
+    PresentTag entries[Capacity];
+    uint32_t window;
+    uint32_t taps;        // Letture trattate come nuovo tap
+    uint32_t repeats;     // Letture di un tag rimasto nel campo
+
+public:
+    explicit PresenceTracker(uint32_t windowMs) : window(windowMs), taps(0), repeats(0) {
+        memset(entries, 0, sizeof(entries));
+    }
+
+    /**
+     * @brief Imposta la finestra di ripetizione
+     * @param windowMs Assenza dopo la quale lo stesso UID conta come nuovo
+     *        tap; deve superare l'intervallo tra due ricerche (con
+     *        InAutoPoll almeno NFC_AUTOPOLL_PERIOD × 150 ms). 0 disattiva
+     *        il filtro.
+     */
+    void setWindow(uint32_t windowMs) { window = windowMs; }
+    uint32_t getWindow() const { return window; }
+
+    /**
+     * @brief Registra la lettura di un tag
+     * @param uid UID del tag (7 byte, completato con zeri)
+     * @param uidLength Byte significativi dell'UID
+     * @param reader Lettore che ha letto il tag
+     * @param now millis() alla lettura
+     * @return true se è un nuovo tap, false se il tag era già nel campo
+     */
+    bool arrive(const uint8_t* uid, uint8_t uidLength, uint8_t reader, uint32_t now) {
+        int8_t slot = -1;
+        for (uint8_t i = 0; i < Capacity; i++) {
+            PresentTag& entry = entries[i];
+            if (entry.uidLength == uidLength && entry.reader == reader &&
+                memcmp(entry.uid, uid, sizeof(entry.uid)) == 0) {
+                bool held = now - entry.lastSeen < window;
+                entry.lastSeen = now;
+                if (held) {
+                    repeats++;
+                    return false;
+                }
+                taps++;
+                return true;
+            }
+            // Voce libera, altrimenti quella vista meno di recente
+            if (slot < 0 || (entries[slot].uidLength != 0 &&
+                (entry.uidLength == 0 || (int32_t)(entry.lastSeen - entries[slot].lastSeen) < 0))) {
+                slot = i;
+            }
+        }
+
+        PresentTag& entry = entries[slot];
+        memcpy(entry.uid, uid, sizeof(entry.uid));
+        entry.uidLength = uidLength;
+        entry.reader = reader;
+        entry.lastSeen = now;
+        taps++;
+        return true;
+    }
+
+    /**
+     * @brief Tag ancora nel campo (letti entro la finestra)
+     */
+    uint8_t present(uint32_t now) const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < Capacity; i++) {
+            if (entries[i].uidLength != 0 && now - entries[i].lastSeen < window) n++;
+        }
+        return n;
+    }
+
+    uint32_t tapCount() const { return taps; }
+    uint32_t repeatCount() const { return repeats; }
+
+    void printStats(Print& out) const {
+        out.print("[PRESENCE] Tap: ");
+        out.print((unsigned long)taps);
+        out.print(", letture ignorate: ");
+        out.print((unsigned long)repeats);
+        out.print(", finestra: ");
+        out.print((unsigned long)window);
+        out.println(" ms");
+    }
+};
+
+#endif
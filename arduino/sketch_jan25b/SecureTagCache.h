@@ -0,0 +1,597 @@
+#ifndef SECURE_TAG_CACHE_H
+#define SECURE_TAG_CACHE_H
+
+#include <Arduino.h>
+#include "LightweightCrypto.h"
+#include "TagFilter.h"
+#include "TagEviction.h"
+#include "Log.h"
+
+// Capacità della cache usata dallo sketch (vedi README per il dimensionamento)
+#ifndef TAG_CACHE_CAPACITY
+#define TAG_CACHE_CAPACITY 128
+#endif
+
+// SECURITY: Strutture dati con packed attribute per minimizzare memoria.
+// I metadati di utilizzo sono gestiti in RAM da TagEvictionPolicy, fuori dal ciphertext.
+struct TagEntry {
+    uint8_t uid[7];        // UID del tag NFC
+    bool valid;            // Flag validità
+} __attribute__((packed));
+
+// Lunghezza minima del ciphertext: TagEntry arrotondato al blocco TEA (8 byte)
+static constexpr uint8_t TAG_CIPHERTEXT_LEN = (sizeof(TagEntry) + 7) & ~7;
+
+/**
+ * @brief Formato cifrato di uno slot della cache
+ * @tparam IvLen Lunghezza dell'IV in byte
+ * @tparam DataLen Lunghezza del ciphertext (multiplo di 8, almeno sizeof(TagEntry))
+ * @tparam MacLen Lunghezza del MAC troncato (massimo 8)
+ */
+template <uint8_t IvLen, uint8_t DataLen, uint8_t MacLen>
+struct TagCacheLayout {
+    static_assert(DataLen % 8 == 0, "Il ciphertext deve essere multiplo del blocco TEA");
+    static_assert(DataLen >= sizeof(TagEntry), "Il ciphertext deve contenere un TagEntry");
+    static_assert(IvLen > 0 && MacLen > 0 && MacLen <= 8, "IV e MAC devono essere tra 1 e 8 byte");
+
+    static constexpr uint8_t IV_LEN = IvLen;
+    static constexpr uint8_t DATA_LEN = DataLen;
+    static constexpr uint8_t MAC_LEN = MacLen;
+
+    struct Record {
+        uint8_t iv[IvLen];     // Vettore di inizializzazione
+        uint8_t data[DataLen]; // Dati cifrati
+        uint8_t mac[MacLen];   // MAC per integrità
+    } __attribute__((packed));
+
+    static constexpr uint8_t RECORD_SIZE = sizeof(Record);
+};
+
+// Formato originale: 48 byte per tag
+typedef TagCacheLayout<8, 32, 8> LegacyLayout;
+// Ciphertext ridotto al minimo numero di blocchi TEA: 32 byte per tag
+typedef TagCacheLayout<8, TAG_CIPHERTEXT_LEN, 8> CompactLayout;
+// IV e MAC da 32 bit, ciphertext minimo: 24 byte per tag
+typedef TagCacheLayout<4, TAG_CIPHERTEXT_LEN, 4> DenseLayout;
+
+typedef LegacyLayout::Record EncryptedData;
+
+// Tipo dell'indice di slot: un byte finché la capacità lo consente
+template <bool Small> struct TagSlotTraits { typedef uint8_t type; };
+template <> struct TagSlotTraits<false> { typedef uint16_t type; };
+
+/**
+ * @brief Dimensione dell'indice hash: potenza di 2 pari ad almeno il doppio della capacità
+ */
+constexpr uint16_t tagIndexSize(uint16_t capacity, uint16_t size = 1) {
+    return size >= 2 * capacity ? size : tagIndexSize(capacity, size * 2);
+}
+
+/**
+ * @brief Cache cifrata dei tag autorizzati
+ * @tparam Capacity Numero massimo di tag memorizzabili
+ * @tparam Layout Formato cifrato degli slot (LegacyLayout, CompactLayout, DenseLayout)
+ */
+template <uint16_t Capacity, typename Layout = DenseLayout>
+class SecureTagCacheT {
+public:
+    typedef typename Layout::Record Record;
+    typedef typename TagSlotTraits<(Capacity < 255)>::type Slot;
+
+    static constexpr uint16_t MAX_TAGS = Capacity;
+    static constexpr uint16_t INDEX_SIZE = tagIndexSize(Capacity);
+
+private:
+    static_assert(Capacity > 0 && Capacity <= 4096, "Capacità della cache non supportata");
+
+    static constexpr Slot INDEX_EMPTY = 0;
+    // Filtro negativo: ~10 bit per tag e 7 hash, falsi positivi sotto l'1% a cache piena
+    static constexpr uint16_t FILTER_BITS = Capacity * 10;
+    static constexpr uint8_t FILTER_HASHES = 7;
+
+    LightweightCrypto crypto;
+    LightweightCrypto masterCrypto;  // Chiave della cache: derivazione delle chiavi
+    LightweightCrypto indexCrypto;   // Chiave dell'indice, derivata: MAC degli UID
+    Record cache[Capacity];
+    uint32_t fingerprints[Capacity]; // MAC troncato dell'UID per ogni slot
+    Slot index[INDEX_SIZE];          // slot + 1, INDEX_EMPTY se libero
+    uint8_t dirty[(Capacity + 7) / 8]; // Slot modificati e non ancora persistiti
+    TagBloomFilter<FILTER_BITS, FILTER_HASHES> filter;
+    TagFilterStats stats;
+    TagEvictionPolicy<Capacity, Slot> policy;
+    uint16_t slotCount;    // Slot occupati almeno una volta: i successivi non sono mai stati scritti
+
+    void deriveEntryKey(const uint8_t* iv);
+    bool readEntry(uint16_t slot, TagEntry& entry);
+    void writeEntry(uint16_t slot, const uint8_t* uid);
+    uint32_t uidFingerprint(const uint8_t* uid);
+    int findSlot(const uint8_t* uid, uint32_t fingerprint);
+    void indexInsert(uint16_t slot);
+    bool indexRemove(uint16_t slot);
+    void rebuildFilter();
+    void recordMissCost(uint32_t elapsed);
+    void markDirty(uint16_t slot) { dirty[slot >> 3] |= (1 << (slot & 7)); }
+
+public:
+    SecureTagCacheT();
+    void clear();
+    bool addTag(const uint8_t* uid);
+    bool verifyTag(const uint8_t* uid);
+    uint16_t size() const { return policy.liveCount(); }
+    uint16_t slotsUsed() const { return slotCount; }
+
+    // Interfaccia per la persistenza (vedi TagCacheStore)
+    bool isDirty(uint16_t slot) const { return dirty[slot >> 3] & (1 << (slot & 7)); }
+    void clearDirty(uint16_t slot) { dirty[slot >> 3] &= ~(1 << (slot & 7)); }
+    int nextDirty(uint16_t from) const;
+    const Record& record(uint16_t slot) const { return cache[slot]; }
+    void reserveSlots(uint16_t count);
+    bool restoreRecord(uint16_t slot, const Record& rec);
+
+    const TagFilterStats& filterStats() const { return stats; }
+    /**
+     * @brief Stima del tempo risparmiato dagli scarti del filtro
+     * @return Scarti per costo medio dei falsi positivi (us), 0 finché non
+     *         c'è un falso positivo che ne misuri il costo
+     */
+    uint32_t savedMicros() const {
+        uint64_t saved = (uint64_t)stats.rejects * stats.missMicros;
+        return saved > UINT32_MAX ? UINT32_MAX : (uint32_t)saved;
+    }
+    void printFilterStats(Print& out) const;
+    uint16_t uses(uint16_t slot) const { return policy.uses(slot); }
+    uint32_t lastUse(uint16_t slot) const { return policy.lastUse(slot); }
+    static void printFootprint(Print& out);
+};
+
+typedef SecureTagCacheT<TAG_CACHE_CAPACITY, DenseLayout> SecureTagCache;
+
+
+// ----------------- SecureTagCacheT Implementation -----------------
+
+
+/**
+ * @brief Costruttore della classe SecureTagCacheT
+ * @details Inizializza la cache con una chiave di default di 16 byte e un indice vuoto.
+ * @security TODO: La chiave dovrebbe essere caricata da un secure storage invece che essere hardcoded
+ */
+template <uint16_t Capacity, typename Layout>
+SecureTagCacheT<Capacity, Layout>::SecureTagCacheT() : slotCount(0) {
+    // SECURITY: La chiave dovrebbe essere caricata da un secure storage
+    uint8_t key[16] = {0x42}; // TODO: Implementare secure storage
+    masterCrypto.setKey(key, 16);
+
+    // Chiave dell'indice = MAC(chiave cache, etichetta): le etichette sono più
+    // lunghe di qualsiasi IV, quindi non coincide con la chiave di uno slot
+    uint8_t label[12] = {'T', 'a', 'g', 'C', 'a', 'c', 'h', 'e', 'I', 'd', 'x', 0};
+    uint8_t indexKey[16];
+    masterCrypto.generateMAC(label, sizeof(label), indexKey);
+    label[11] = 1;
+    masterCrypto.generateMAC(label, sizeof(label), indexKey + 8);
+    indexCrypto.setKey(indexKey, 16);
+    memset(indexKey, 0, sizeof(indexKey));
+    memset(key, 0, sizeof(key));
+    clear();
+}
+
+/**
+ * @brief Svuota la cache e l'indice
+ * @security Azzera anche i dati cifrati per evitare residui in RAM
+ */
+template <uint16_t Capacity, typename Layout>
+void SecureTagCacheT<Capacity, Layout>::clear() {
+    memset(cache, 0, sizeof(cache));
+    memset(fingerprints, 0, sizeof(fingerprints));
+    memset(index, 0, sizeof(index));
+    memset(dirty, 0, sizeof(dirty));
+    memset(&stats, 0, sizeof(stats));
+    filter.clear();
+    policy.clear();
+    slotCount = 0;
+}
+
+/**
+ * @brief Deriva la chiave di cifratura di uno slot a partire dal suo IV
+ * @param iv Vettore di inizializzazione dello slot
+ * @security La chiave è MAC(chiave cache, IV): con IV corti non è ricavabile senza la chiave della cache
+ */
+template <uint16_t Capacity, typename Layout>
+void SecureTagCacheT<Capacity, Layout>::deriveEntryKey(const uint8_t* iv) {
+    uint8_t derivedKey8[8];
+    masterCrypto.generateMAC(iv, Layout::IV_LEN, derivedKey8);
+    uint8_t fullKey[16];
+    memcpy(fullKey, derivedKey8, 8);
+    memcpy(fullKey + 8, derivedKey8, 8);
+    crypto.setKey(fullKey, 16);
+    memset(fullKey, 0, sizeof(fullKey));
+}
+
+/**
+ * @brief Decifra una copia dello slot indicato
+ * @param slot Indice dello slot da leggere
+ * @param entry Struttura di output con il tag in chiaro
+ * @return true se il MAC è valido, false altrimenti
+ * @security Il contenuto cifrato in cache non viene mai modificato
+ */
+template <uint16_t Capacity, typename Layout>
+bool SecureTagCacheT<Capacity, Layout>::readEntry(uint16_t slot, TagEntry& entry) {
+    uint8_t tempData[Layout::DATA_LEN];
+    memcpy(tempData, cache[slot].data, Layout::DATA_LEN);
+
+    deriveEntryKey(cache[slot].iv);
+
+    uint8_t calculatedMac[8];
+    crypto.generateMAC(tempData, Layout::DATA_LEN, calculatedMac);
+    bool integrityOk = (memcmp(calculatedMac, cache[slot].mac, Layout::MAC_LEN) == 0);
+
+    crypto.decrypt(tempData, Layout::DATA_LEN);
+    memcpy(&entry, tempData, sizeof(TagEntry));
+    memset(tempData, 0, sizeof(tempData));
+    return integrityOk;
+}
+
+/**
+ * @brief Cifra un nuovo tag nello slot indicato
+ * @param slot Indice dello slot da scrivere
+ * @param uid UID del tag (7 byte)
+ * @security Genera un IV nuovo ad ogni scrittura e ricalcola il MAC
+ */
+template <uint16_t Capacity, typename Layout>
+void SecureTagCacheT<Capacity, Layout>::writeEntry(uint16_t slot, const uint8_t* uid) {
+    TagEntry newTag = {};
+    memcpy(newTag.uid, uid, 7);
+    newTag.valid = true;
+
+    for (uint8_t i = 0; i < Layout::IV_LEN; i++) {
+        cache[slot].iv[i] = random(256);
+    }
+    deriveEntryKey(cache[slot].iv);
+
+    memset(cache[slot].data, 0, Layout::DATA_LEN);
+    memcpy(cache[slot].data, &newTag, sizeof(TagEntry));
+    crypto.encrypt(cache[slot].data, Layout::DATA_LEN);
+
+    uint8_t mac[8];
+    crypto.generateMAC(cache[slot].data, Layout::DATA_LEN, mac);
+    memcpy(cache[slot].mac, mac, Layout::MAC_LEN);
+
+    fingerprints[slot] = uidFingerprint(uid);
+    markDirty(slot);
+}
+
+/**
+ * @brief Calcola l'impronta dell'UID usata come chiave dell'indice
+ * @param uid UID del tag (7 byte)
+ * @return I primi 32 bit del MAC dell'UID
+ * @security L'impronta è un MAC con la chiave dell'indice, derivata da quella
+ *           della cache e distinta dalle chiavi degli slot: non rivela l'UID
+ *           né alcuna chiave di cifratura
+ */
+template <uint16_t Capacity, typename Layout>
+uint32_t SecureTagCacheT<Capacity, Layout>::uidFingerprint(const uint8_t* uid) {
+    uint8_t mac[8];
+    indexCrypto.generateMAC(uid, 7, mac);
+    uint32_t fingerprint;
+    memcpy(&fingerprint, mac, 4);
+    return fingerprint;
+}
+
+/**
+ * @brief Cerca lo slot che contiene l'UID tramite l'indice hash
+ * @param uid UID del tag (7 byte)
+ * @param fingerprint Impronta dell'UID calcolata con uidFingerprint()
+ * @return Indice dello slot, -1 se il tag non è in cache
+ * @details Scansione lineare a partire dal bucket dell'impronta: vengono
+ *          decifrati solo gli slot la cui impronta coincide
+ */
+template <uint16_t Capacity, typename Layout>
+int SecureTagCacheT<Capacity, Layout>::findSlot(const uint8_t* uid, uint32_t fingerprint) {
+    uint16_t pos = fingerprint & (INDEX_SIZE - 1);
+    for (uint16_t probes = 0; probes < INDEX_SIZE; probes++) {
+        if (index[pos] == INDEX_EMPTY) break;
+
+        uint16_t slot = index[pos] - 1;
+        if (fingerprints[slot] == fingerprint) {
+            TagEntry tag;
+            bool integrityOk = readEntry(slot, tag);
+            bool match = integrityOk && tag.valid && (memcmp(tag.uid, uid, 7) == 0);
+            memset(&tag, 0, sizeof(tag));
+            if (match) return slot;
+        }
+        pos = (pos + 1) & (INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief Inserisce uno slot nell'indice in base alla sua impronta
+ * @param slot Indice dello slot da indicizzare
+ */
+template <uint16_t Capacity, typename Layout>
+void SecureTagCacheT<Capacity, Layout>::indexInsert(uint16_t slot) {
+    uint16_t pos = fingerprints[slot] & (INDEX_SIZE - 1);
+    while (index[pos] != INDEX_EMPTY) {
+        pos = (pos + 1) & (INDEX_SIZE - 1);
+    }
+    index[pos] = slot + 1;
+}
+
+/**
+ * @brief Rimuove uno slot dall'indice
+ * @param slot Indice dello slot da rimuovere
+ * @return true se lo slot era indicizzato, false altrimenti
+ * @details Usa la cancellazione con backward shift, così l'indice non
+ *          accumula tombstone e le ricerche restano brevi
+ */
+template <uint16_t Capacity, typename Layout>
+bool SecureTagCacheT<Capacity, Layout>::indexRemove(uint16_t slot) {
+    // Il bucket di partenza è noto: si scorre solo il cluster dello slot
+    uint16_t hole = fingerprints[slot] & (INDEX_SIZE - 1);
+    uint16_t probes = 0;
+    while (index[hole] != slot + 1) {
+        if (index[hole] == INDEX_EMPTY || ++probes == INDEX_SIZE) return false;
+        hole = (hole + 1) & (INDEX_SIZE - 1);
+    }
+
+    uint16_t pos = hole;
+    while (true) {
+        pos = (pos + 1) & (INDEX_SIZE - 1);
+        if (index[pos] == INDEX_EMPTY) break;
+
+        uint16_t home = fingerprints[index[pos] - 1] & (INDEX_SIZE - 1);
+        // Sposta l'elemento nel buco solo se il suo bucket non cade tra buco e posizione attuale
+        bool movable = (hole <= pos) ? (home <= hole || home > pos)
+                                     : (home <= hole && home > pos);
+        if (movable) {
+            index[hole] = index[pos];
+            hole = pos;
+        }
+    }
+    index[hole] = INDEX_EMPTY;
+    return true;
+}
+
+/**
+ * @brief Ricostruisce il filtro negativo dalle impronte degli slot indicizzati
+ * @details Il filtro non supporta rimozioni: va ricostruito quando uno slot
+ *          viene sostituito. Non richiede decifrature.
+ */
+template <uint16_t Capacity, typename Layout>
+void SecureTagCacheT<Capacity, Layout>::rebuildFilter() {
+    filter.clear();
+    for (uint16_t pos = 0; pos < INDEX_SIZE; pos++) {
+        if (index[pos] != INDEX_EMPTY) {
+            filter.add(fingerprints[index[pos] - 1]);
+        }
+    }
+    stats.rebuilds++;
+}
+
+/**
+ * @brief Aggiorna il costo medio di una ricerca fallita nell'indice
+ * @param elapsed Durata della ricerca in microsecondi
+ */
+template <uint16_t Capacity, typename Layout>
+void SecureTagCacheT<Capacity, Layout>::recordMissCost(uint32_t elapsed) {
+    stats.missMicros = stats.missMicros ? (stats.missMicros * 7 + elapsed) / 8 : elapsed;
+}
+
+/**
+ * @brief Aggiunge un nuovo tag NFC alla cache sicura di Arduino
+ * @param uid Array di byte contenente l'identificativo univoco del tag NFC
+ * @return true se il tag è stato aggiunto con successo, false altrimenti
+ * @security Implementa:
+ *  - Generazione sicura di IV casuali
+ *  - Cifratura dei dati con algoritmo TEA (Tiny Encryption Algorithm)
+ *  - Generazione MAC per integrità
+ */
+template <uint16_t Capacity, typename Layout>
+bool SecureTagCacheT<Capacity, Layout>::addTag(const uint8_t* uid) {
+    // Controlla se il tag è già in cache tramite l'indice
+    uint32_t fingerprint = uidFingerprint(uid);
+    if (findSlot(uid, fingerprint) >= 0) {
+        // Se il tag esiste già, non aggiungere duplicati
+        return true;
+    }
+
+    // Riusa uno slot libero, altrimenti se la cache è piena sostituisci
+    // la vittima scelta in O(1) dalla politica SLRU
+    if (policy.hasFree() || slotCount >= Capacity) {
+        Slot victim = policy.victim();
+        if (victim == policy.NONE) return false;
+
+        bool replaced = indexRemove(victim);
+        writeEntry(victim, uid);
+        indexInsert(victim);
+        policy.insert(victim, millis());
+        if (replaced) {
+            rebuildFilter();
+        } else {
+            filter.add(fingerprints[victim]);
+        }
+        return true;
+    }
+
+    // Aggiunta di un nuovo tag quando c'è spazio
+    writeEntry(slotCount, uid);
+    indexInsert(slotCount);
+    filter.add(fingerprints[slotCount]);
+    policy.insert(slotCount, millis());
+    slotCount++;
+    return true;
+}
+
+
+/**
+ * @brief Verifica se un tag NFC è presente nella cache e se è valido
+ * @param uid Array di byte contenente l'identificativo univoco del tag da verificare
+ * @return true se il tag è valido e presente in cache, false altrimenti
+ * @security Implementa:
+ *  - Filtro negativo: gli UID sicuramente assenti sono scartati senza consultare l'indice
+ *  - Ricerca tramite indice hash con chiave: vengono decifrati solo gli slot candidati
+ *  - Verifica dell'integrità tramite MAC
+ *  - Decifratura sicura dei dati
+ *  - Logging non sensibile delle operazioni
+ */
+template <uint16_t Capacity, typename Layout>
+bool SecureTagCacheT<Capacity, Layout>::verifyTag(const uint8_t* uid) {
+
+    LOG_DEBUG.print("Numero di tag in cache: ");
+    LOG_DEBUG.println(size());
+
+    uint32_t fingerprint = uidFingerprint(uid);
+    stats.lookups++;
+
+    if (!filter.mayContain(fingerprint)) {
+        stats.rejects++;
+        LOG_DEBUG.println("Verifica tag fallita");
+        return false;
+    }
+
+    uint32_t start = micros();
+    int slot = findSlot(uid, fingerprint);
+    if (slot >= 0) {
+        policy.touch(slot, millis());
+        LOG_DEBUG.println("Tag verificato con successo!");
+        return true;
+    }
+    recordMissCost(micros() - start);
+    stats.falsePositives++;
+
+    LOG_DEBUG.println("Verifica tag fallita");
+    return false;
+}
+
+
+/**
+ * @brief Restituisce il primo slot modificato a partire da quello indicato
+ * @param from Slot da cui iniziare la ricerca
+ * @return Indice dello slot, -1 se non ci sono slot da persistere
+ */
+template <uint16_t Capacity, typename Layout>
+int SecureTagCacheT<Capacity, Layout>::nextDirty(uint16_t from) const {
+    for (uint16_t slot = from; slot < slotCount; slot++) {
+        // Salta rapidamente i byte senza slot modificati
+        if ((slot & 7) == 0 && dirty[slot >> 3] == 0) {
+            slot += 7;
+            continue;
+        }
+        if (isDirty(slot)) return slot;
+    }
+    return -1;
+}
+
+/**
+ * @brief Riserva gli slot occupati nello storage persistente
+ * @param count Numero di slot presenti nello storage
+ * @details Chiamato prima del ripristino, così i tag aggiunti durante
+ *          il ripristino non occupano slot ancora da caricare
+ */
+template <uint16_t Capacity, typename Layout>
+void SecureTagCacheT<Capacity, Layout>::reserveSlots(uint16_t count) {
+    if (count > Capacity) count = Capacity;
+    if (count > slotCount) slotCount = count;
+}
+
+/**
+ * @brief Ripristina uno slot letto dallo storage persistente
+ * @param slot Indice dello slot
+ * @param rec Record cifrato letto dallo storage
+ * @return true se lo slot è stato ripristinato e indicizzato, false altrimenti
+ * @security Il record viene accettato solo se il MAC è valido. Gli slot
+ *           modificati dopo l'avvio hanno la precedenza su quelli salvati,
+ *           e un UID già presente in cache non viene duplicato. Uno slot
+ *           scartato viene segnato come modificato: TagCacheStore salva un
+ *           record vuoto che lo cancella dal log.
+ */
+template <uint16_t Capacity, typename Layout>
+bool SecureTagCacheT<Capacity, Layout>::restoreRecord(uint16_t slot, const Record& rec) {
+    if (slot >= Capacity || isDirty(slot)) return false;
+    reserveSlots(slot + 1);
+
+    bool replaced = indexRemove(slot);
+    memcpy(&cache[slot], &rec, sizeof(Record));
+
+    TagEntry tag;
+    bool restored = false;
+    if (readEntry(slot, tag) && tag.valid) {
+        uint32_t fingerprint = uidFingerprint(tag.uid);
+        if (findSlot(tag.uid, fingerprint) < 0) {
+            fingerprints[slot] = fingerprint;
+            indexInsert(slot);
+            filter.add(fingerprint);
+            policy.insert(slot, millis());
+            restored = true;
+        }
+    }
+    memset(&tag, 0, sizeof(tag));
+    if (replaced) rebuildFilter();
+
+    if (!restored) {
+        // Slot non valido o duplicato: resta libero ed è il primo candidato
+        // alla sostituzione. Il record azzerato viene persistito come
+        // cancellazione, altrimenti il vecchio record tornerebbe a ogni avvio;
+        // un record già azzerato non viene riscritto
+        bool blank = true;
+        const uint8_t* raw = (const uint8_t*)&cache[slot];
+        for (size_t i = 0; i < sizeof(Record) && blank; i++) blank = raw[i] == 0;
+        memset(&cache[slot], 0, sizeof(Record));
+        policy.release(slot);
+        if (!blank) markDirty(slot);
+    }
+    return restored;
+}
+
+/**
+ * @brief Stampa i contatori del filtro negativo
+ * @param out Destinazione della stampa (es. Serial)
+ * @details Il tasso di falsi positivi è calcolato sulle sole ricerche di UID assenti
+ */
+template <uint16_t Capacity, typename Layout>
+void SecureTagCacheT<Capacity, Layout>::printFilterStats(Print& out) const {
+    uint32_t absent = stats.rejects + stats.falsePositives;
+    out.print("[FILTER] Ricerche: ");
+    out.print((unsigned long)stats.lookups);
+    out.print(", scartate: ");
+    out.print((unsigned long)stats.rejects);
+    out.print(", falsi positivi: ");
+    out.print((unsigned long)stats.falsePositives);
+    out.print(" (");
+    out.print(absent ? (float)stats.falsePositives * 100.0f / absent : 0.0f);
+    out.println("%)");
+    // Il costo di una ricerca fallita si misura solo sui falsi positivi
+    if (stats.falsePositives == 0) {
+        out.println("[FILTER] Costo ricerca fallita: n/d (nessun falso positivo), tempo risparmiato: n/d");
+        return;
+    }
+    out.print("[FILTER] Costo ricerca fallita: ");
+    out.print((unsigned long)stats.missMicros);
+    out.print(" us, tempo risparmiato: ");
+    out.print((unsigned long)savedMicros());
+    out.println(" us");
+}
+
+/**
+ * @brief Stampa l'occupazione di memoria della configurazione
+ * @param out Destinazione della stampa (es. Serial)
+ * @details Utile per dimensionare capacità e layout in base a RAM ed EEPROM disponibili
+ */
+template <uint16_t Capacity, typename Layout>
+void SecureTagCacheT<Capacity, Layout>::printFootprint(Print& out) {
+    out.print("[CACHE] Capacita': ");
+    out.print((unsigned long)Capacity);
+    out.print(" tag, slot: ");
+    out.print((unsigned long)Layout::RECORD_SIZE);
+    out.print(" byte (IV ");
+    out.print((unsigned long)Layout::IV_LEN);
+    out.print(", dati ");
+    out.print((unsigned long)Layout::DATA_LEN);
+    out.print(", MAC ");
+    out.print((unsigned long)Layout::MAC_LEN);
+    out.println(")");
+    out.print("[CACHE] RAM: ");
+    out.print((unsigned long)sizeof(SecureTagCacheT));
+    out.println(" byte");
+}
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef TAG_CACHE_STORE_H
+#define TAG_CACHE_STORE_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+// Area EEPROM riservata al log della cache (il resto resta libero per altri usi)
+#ifndef TAG_STORE_EEPROM_BASE
+#define TAG_STORE_EEPROM_BASE 0
+#endif
+#ifndef TAG_STORE_EEPROM_SIZE
+#define TAG_STORE_EEPROM_SIZE 6144
+#endif
+
+/**
+ * @brief Persistenza log-structured e wear-levelled della cache dei tag
+ * @tparam Cache Istanza di SecureTagCacheT da persistere
+ * @details L'area EEPROM è un buffer circolare di record a dimensione fissa
+ *          [marker | seq | slot | record cifrato | crc8]. Gli slot modificati
+ *          vengono accodati in testa al log, la compattazione ricopia in testa
+ *          i record ancora validi che si trovano in coda: le scritture ruotano
+ *          su tutta l'area e ogni cella viene usata in modo uniforme.
+ *          Tutto il lavoro avviene in tick(), a piccoli passi, dal loop().
+ */
+template <typename Cache>
+class TagCacheStore {
+public:
+    typedef typename Cache::Record Record;
+
+    static constexpr uint8_t HEADER_SIZE = 7;
+    static constexpr uint8_t ENTRY_SIZE = HEADER_SIZE + sizeof(Record) + 1;
+
+private:
+    // Il marker dipende dalla dimensione del record: un log scritto con un
+    // layout diverso viene ignorato invece di essere interpretato male
+    static constexpr uint8_t MARKER_VALID = 0x80 | sizeof(Record);
+    static constexpr uint8_t MARKER_WRITING = 0x00;
+    static constexpr uint16_t NO_POS = 0xFFFF;
+    // Record elaborati per ogni chiamata a tick() durante il ripristino
+    static constexpr uint8_t RESTORE_BATCH = 8;
+    // Posizioni libere sotto le quali parte la compattazione
+    static constexpr uint8_t COMPACT_THRESHOLD = 8;
+
+    enum State : uint8_t {
+        STATE_IDLE,       // begin() non ancora chiamato o area troppo piccola
+        STATE_SCANNING,   // Ricerca dell'ultima versione di ogni slot
+        STATE_RESTORING,  // Caricamento in cache degli slot trovati
+        STATE_READY
+    };
+
+    Cache& cache;
+    uint16_t base;
+    uint16_t numEntries;
+    uint16_t slotPos[Cache::MAX_TAGS]; // Posizione dell'ultima versione di ogni slot
+    uint16_t head;      // Prossima posizione da scrivere
+    uint16_t tail;      // Record più vecchio potenzialmente ancora valido
+    uint16_t live;      // Record validi nel log
+    uint32_t nextSeq;
+    uint32_t tailSeq;   // Sequenza minima tra i record validi (durante il ripristino)
+    uint16_t cursor;    // Avanzamento di scansione/ripristino
+    State state;
+    uint32_t appends;
+    uint32_t relocations;
+
+    uint16_t entryAddress(uint16_t pos) const { return base + pos * ENTRY_SIZE; }
+    uint16_t nextPos(uint16_t pos) const { return (pos + 1 == numEntries) ? 0 : pos + 1; }
+    uint16_t used() const { return (head + numEntries - tail) % numEntries; }
+
+    static uint8_t crc8(uint8_t crc, const uint8_t* data, size_t len);
+    bool readEntry(uint16_t pos, uint32_t& seq, uint16_t& slot, Record* rec);
+    void writeEntry(uint16_t slot, const Record& rec);
+    void scanStep();
+    void restoreStep();
+    bool compactStep();
+
+public:
+    TagCacheStore(Cache& tagCache, uint16_t eepromBase = TAG_STORE_EEPROM_BASE,
+                  uint16_t eepromSize = TAG_STORE_EEPROM_SIZE);
+    bool begin();
+    void tick();
+    bool flush();
+    bool isReady() const { return state == STATE_READY; }
+    uint32_t writeCount() const { return appends; }
+    uint32_t relocationCount() const { return relocations; }
+    void printFootprint(Print& out) const;
+};
+
+
+// ----------------- TagCacheStore Implementation -----------------
+
+
+/**
+ * @brief Costruttore della classe TagCacheStore
+ * @param tagCache Cache da persistere
+ * @param eepromBase Primo byte dell'area EEPROM riservata
+ * @param eepromSize Dimensione in byte dell'area EEPROM riservata
+ */
+template <typename Cache>
+TagCacheStore<Cache>::TagCacheStore(Cache& tagCache, uint16_t eepromBase, uint16_t eepromSize)
+  : cache(tagCache), base(eepromBase), numEntries(eepromSize / ENTRY_SIZE),
+    head(0), tail(0), live(0), nextSeq(1), tailSeq(0), cursor(0), state(STATE_IDLE),
+    appends(0), relocations(0)
+{
+    for (uint16_t i = 0; i < Cache::MAX_TAGS; i++) {
+        slotPos[i] = NO_POS;
+    }
+}
+
+/**
+ * @brief Avvia il ripristino della cache dalla EEPROM
+ * @return true se l'area è sufficiente, false altrimenti
+ * @details Esegue subito solo la scansione degli header (letture e CRC,
+ *          pochi ms) e riserva gli slot trovati. La decifratura degli slot
+ *          prosegue in tick(): nel frattempo la cache risponde con i tag già
+ *          caricati e i tag mancanti seguono la verifica remota.
+ */
+template <typename Cache>
+bool TagCacheStore<Cache>::begin() {
+    // Serve spazio libero oltre ai record validi per poter compattare
+    if (numEntries < Cache::MAX_TAGS + Cache::MAX_TAGS / 4 + 2 ||
+        (uint32_t)base + (uint32_t)numEntries * ENTRY_SIZE > EEPROM.length()) {
+        state = STATE_IDLE;
+        return false;
+    }
+    cursor = 0;
+    state = STATE_SCANNING;
+    while (state == STATE_SCANNING) {
+        scanStep();
+    }
+    return true;
+}
+
+/**
+ * @brief CRC-8 (polinomio 0x07) per rilevare record scritti a metà
+ */
+template <typename Cache>
+uint8_t TagCacheStore<Cache>::crc8(uint8_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Legge e valida un record del log
+ * @param pos Posizione nel buffer circolare
+ * @param seq Numero di sequenza letto
+ * @param slot Slot della cache a cui si riferisce il record
+ * @param rec Record cifrato di output (può essere nullptr)
+ * @return true se il record è completo e integro, false altrimenti
+ */
+template <typename Cache>
+bool TagCacheStore<Cache>::readEntry(uint16_t pos, uint32_t& seq, uint16_t& slot, Record* rec) {
+    uint8_t buffer[ENTRY_SIZE];
+    uint16_t addr = entryAddress(pos);
+    for (uint8_t i = 0; i < ENTRY_SIZE; i++) {
+        buffer[i] = EEPROM.read(addr + i);
+    }
+    if (buffer[0] != MARKER_VALID) return false;
+    if (crc8(0, buffer, ENTRY_SIZE - 1) != buffer[ENTRY_SIZE - 1]) return false;
+
+    memcpy(&seq, buffer + 1, 4);
+    memcpy(&slot, buffer + 5, 2);
+    if (slot >= Cache::MAX_TAGS) return false;
+    if (rec) memcpy(rec, buffer + HEADER_SIZE, sizeof(Record));
+    return true;
+}
+
+/**
+ * @brief Accoda un record in testa al log
+ * @param slot Slot della cache
+ * @param rec Record cifrato da salvare
+ * @details Il marker viene invalidato per primo e riscritto per ultimo: un
+ *          record interrotto da un reset ha CRC errato e viene ignorato
+ */
+template <typename Cache>
+void TagCacheStore<Cache>::writeEntry(uint16_t slot, const Record& rec) {
+    uint8_t buffer[ENTRY_SIZE];
+    buffer[0] = MARKER_VALID;
+    memcpy(buffer + 1, &nextSeq, 4);
+    memcpy(buffer + 5, &slot, 2);
+    memcpy(buffer + HEADER_SIZE, &rec, sizeof(Record));
+    buffer[ENTRY_SIZE - 1] = crc8(0, buffer, ENTRY_SIZE - 1);
+
+    uint16_t addr = entryAddress(head);
+    EEPROM.update(addr, MARKER_WRITING);
+    for (uint8_t i = 1; i < ENTRY_SIZE; i++) {
+        EEPROM.update(addr + i, buffer[i]);
+    }
+    EEPROM.update(addr, MARKER_VALID);
+
+    if (slotPos[slot] == NO_POS) live++;
+    slotPos[slot] = head;
+    head = nextPos(head);
+    nextSeq++;
+    appends++;
+}
+
+/**
+ * @brief Scansione incrementale: trova l'ultima versione di ogni slot
+ */
+template <typename Cache>
+void TagCacheStore<Cache>::scanStep() {
+    for (uint8_t n = 0; n < RESTORE_BATCH && cursor < numEntries; n++, cursor++) {
+        uint32_t seq, knownSeq;
+        uint16_t slot, knownSlot;
+        if (!readEntry(cursor, seq, slot, nullptr)) continue;
+
+        if (slotPos[slot] == NO_POS ||
+            !readEntry(slotPos[slot], knownSeq, knownSlot, nullptr) || seq > knownSeq) {
+            if (slotPos[slot] == NO_POS) live++;
+            slotPos[slot] = cursor;
+        }
+        if (seq >= nextSeq) {
+            nextSeq = seq + 1;
+            head = nextPos(cursor);
+        }
+    }
+
+    if (cursor == numEntries) {
+        // Gli slot trovati vengono riservati subito: i nuovi tag non li occupano
+        uint16_t highest = 0;
+        for (uint16_t slot = 0; slot < Cache::MAX_TAGS; slot++) {
+            if (slotPos[slot] != NO_POS) highest = slot + 1;
+        }
+        cache.reserveSlots(highest);
+        cursor = 0;
+        tail = head;
+        tailSeq = UINT32_MAX;
+        state = STATE_RESTORING;
+    }
+}
+
+/**
+ * @brief Ripristino incrementale: carica in cache gli slot trovati
+ * @details Calcola anche la coda del log, cioè il record valido più vecchio
+ */
+template <typename Cache>
+void TagCacheStore<Cache>::restoreStep() {
+    for (uint8_t n = 0; n < RESTORE_BATCH && cursor < Cache::MAX_TAGS; n++, cursor++) {
+        uint16_t pos = slotPos[cursor];
+        if (pos == NO_POS) continue;
+
+        Record rec;
+        uint32_t seq;
+        uint16_t slot;
+        if (!readEntry(pos, seq, slot, &rec)) continue;
+        cache.restoreRecord(cursor, rec);
+
+        if (seq < tailSeq) {
+            tailSeq = seq;
+            tail = pos;
+        }
+    }
+
+    if (cursor == Cache::MAX_TAGS) {
+        state = STATE_READY;
+    }
+}
+
+/**
+ * @brief Un passo di compattazione: libera la posizione in coda al log
+ * @return true se è stato scritto un record, false altrimenti
+ * @details Se il record in coda è ancora l'ultima versione del suo slot
+ *          viene ricopiato in testa, altrimenti la posizione è già libera
+ */
+template <typename Cache>
+bool TagCacheStore<Cache>::compactStep() {
+    if (tail == head) return false;
+
+    uint16_t pos = tail;
+    tail = nextPos(tail);
+
+    Record rec;
+    uint32_t seq;
+    uint16_t slot;
+    if (!readEntry(pos, seq, slot, &rec) || slotPos[slot] != pos) return false;
+
+    slotPos[slot] = NO_POS;
+    live--;
+    writeEntry(slot, rec);
+    relocations++;
+    return true;
+}
+
+/**
+ * @brief Avanza ripristino, persistenza e compattazione di un piccolo passo
+ * @details Da chiamare ad ogni iterazione del loop() quando non ci sono tag
+ *          da gestire. Ogni chiamata scrive al più un record in EEPROM.
+ */
+template <typename Cache>
+void TagCacheStore<Cache>::tick() {
+    switch (state) {
+        case STATE_RESTORING:
+            restoreStep();
+            return;
+        case STATE_READY:
+            break;
+        default:
+            return;
+    }
+
+    // Compattazione in background solo quando lo spazio libero si esaurisce:
+    // più record morti si accumulano in coda, meno record validi vanno ricopiati
+    if (numEntries - used() <= COMPACT_THRESHOLD && compactStep()) {
+        return;
+    }
+
+    // Una posizione resta sempre libera per distinguere log pieno e log vuoto
+    int slot = cache.nextDirty(0);
+    if (slot >= 0 && numEntries - used() > 1) {
+        cache.clearDirty(slot);
+        writeEntry(slot, cache.record(slot));
+    }
+}
+
+/**
+ * @brief Persiste subito tutti gli slot modificati
+ * @return true se tutti gli slot sono stati salvati, false se il ripristino non è concluso
+ */
+template <typename Cache>
+bool TagCacheStore<Cache>::flush() {
+    if (state != STATE_READY) return false;
+    while (cache.nextDirty(0) >= 0) {
+        tick();
+    }
+    return true;
+}
+
+/**
+ * @brief Stampa l'occupazione dell'area EEPROM
+ * @param out Destinazione della stampa (es. Serial)
+ */
+template <typename Cache>
+void TagCacheStore<Cache>::printFootprint(Print& out) const {
+    out.print("[STORE] EEPROM: ");
+    out.print((unsigned long)numEntries * ENTRY_SIZE);
+    out.print(" byte, record: ");
+    out.print((unsigned long)numEntries);
+    out.print(" da ");
+    out.print((unsigned long)ENTRY_SIZE);
+    out.print(" byte, validi: ");
+    out.println((unsigned long)live);
+}
+
+#endif
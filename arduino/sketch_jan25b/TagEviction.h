@@ -0,0 +1,135 @@
+#ifndef TAG_EVICTION_H
+#define TAG_EVICTION_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Politica di sostituzione SLRU (Segmented LRU) per gli slot della cache
+ * @tparam Capacity Numero di slot gestiti
+ * @tparam Slot Tipo intero usato per gli indici di slot
+ * @details Gli slot nuovi entrano nel segmento di prova; al primo utilizzo
+ *          passano nel segmento protetto. La vittima è lo slot usato meno di
+ *          recente nel segmento di prova, quindi i badge usati spesso restano
+ *          in cache anche quando molti tag occasionali vengono aggiunti.
+ *          Tutte le operazioni sono O(1): liste doppiamente collegate su array.
+ *          I metadati di utilizzo restano fuori dal ciphertext.
+ */
+template <uint16_t Capacity, typename Slot>
+class TagEvictionPolicy {
+public:
+    static constexpr Slot NONE = (Slot)~(Slot)0;
+
+private:
+    enum Segment : uint8_t {
+        SEG_NONE,       // Slot non gestito (mai assegnato o in ripristino)
+        SEG_FREE,       // Slot libero, riutilizzato prima di ogni sostituzione
+        SEG_PROBATION,  // Slot aggiunto e non ancora usato
+        SEG_PROTECTED   // Slot usato almeno una volta
+    };
+
+    struct List {
+        Slot head;      // Usato più di recente
+        Slot tail;      // Usato meno di recente
+        uint16_t count;
+    };
+
+    // Il segmento protetto occupa al massimo l'80% della cache
+    static constexpr uint16_t PROTECTED_MAX = Capacity - Capacity / 5;
+
+    Slot prev[Capacity];
+    Slot next[Capacity];
+    uint8_t segment[Capacity];
+    uint16_t useCount[Capacity];
+    uint32_t lastUsed[Capacity];
+    List lists[4];
+
+    void unlink(Slot slot) {
+        List& list = lists[segment[slot]];
+        if (prev[slot] != NONE) next[prev[slot]] = next[slot]; else list.head = next[slot];
+        if (next[slot] != NONE) prev[next[slot]] = prev[slot]; else list.tail = prev[slot];
+        list.count--;
+        segment[slot] = SEG_NONE;
+    }
+
+    void pushFront(Slot slot, Segment seg) {
+        List& list = lists[seg];
+        prev[slot] = NONE;
+        next[slot] = list.head;
+        if (list.head != NONE) prev[list.head] = slot; else list.tail = slot;
+        list.head = slot;
+        list.count++;
+        segment[slot] = seg;
+    }
+
+public:
+    TagEvictionPolicy() { clear(); }
+
+    void clear() {
+        for (uint8_t i = 0; i < 4; i++) {
+            lists[i].head = lists[i].tail = NONE;
+            lists[i].count = 0;
+        }
+        memset(segment, SEG_NONE, sizeof(segment));
+        memset(useCount, 0, sizeof(useCount));
+        memset(lastUsed, 0, sizeof(lastUsed));
+    }
+
+    /**
+     * @brief Registra uno slot appena scritto nel segmento di prova
+     */
+    void insert(Slot slot, uint32_t now) {
+        if (segment[slot] != SEG_NONE) unlink(slot);
+        useCount[slot] = 0;
+        lastUsed[slot] = now;
+        pushFront(slot, SEG_PROBATION);
+    }
+
+    /**
+     * @brief Registra un utilizzo dello slot (verifica riuscita)
+     * @details Promuove lo slot nel segmento protetto; se questo è pieno,
+     *          il suo slot meno recente torna nel segmento di prova
+     */
+    void touch(Slot slot, uint32_t now) {
+        if (segment[slot] != SEG_PROBATION && segment[slot] != SEG_PROTECTED) return;
+        if (useCount[slot] < UINT16_MAX) useCount[slot]++;
+        lastUsed[slot] = now;
+
+        unlink(slot);
+        pushFront(slot, SEG_PROTECTED);
+        if (lists[SEG_PROTECTED].count > PROTECTED_MAX) {
+            Slot demoted = lists[SEG_PROTECTED].tail;
+            unlink(demoted);
+            pushFront(demoted, SEG_PROBATION);
+        }
+    }
+
+    /**
+     * @brief Segna lo slot come libero: sarà il primo a essere riutilizzato
+     */
+    void release(Slot slot) {
+        if (segment[slot] != SEG_NONE) unlink(slot);
+        useCount[slot] = 0;
+        pushFront(slot, SEG_FREE);
+    }
+
+    /**
+     * @brief Restituisce lo slot da sostituire senza rimuoverlo
+     * @return Uno slot libero se presente, altrimenti il meno recente del
+     *         segmento di prova, poi del segmento protetto; NONE se non ci sono slot
+     */
+    Slot victim() const {
+        if (lists[SEG_FREE].tail != NONE) return lists[SEG_FREE].tail;
+        if (lists[SEG_PROBATION].tail != NONE) return lists[SEG_PROBATION].tail;
+        return lists[SEG_PROTECTED].tail;
+    }
+
+    bool hasFree() const { return lists[SEG_FREE].count > 0; }
+    bool isProtected(Slot slot) const { return segment[slot] == SEG_PROTECTED; }
+    uint16_t uses(Slot slot) const { return useCount[slot]; }
+    uint32_t lastUse(Slot slot) const { return lastUsed[slot]; }
+    uint16_t protectedCount() const { return lists[SEG_PROTECTED].count; }
+    // Slot con un tag valido (segmenti di prova e protetto)
+    uint16_t liveCount() const { return lists[SEG_PROBATION].count + lists[SEG_PROTECTED].count; }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TAG_FILTER_H
+#define TAG_FILTER_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Filtro di Bloom sulle impronte degli UID in cache
+ * @tparam Bits Numero di bit del filtro
+ * @tparam Hashes Numero di funzioni hash (bit impostati per ogni impronta)
+ * @details Le posizioni dei bit sono derivate con double hashing dall'impronta
+ *          a 32 bit dell'UID, che è già un MAC con la chiave della cache:
+ *          il filtro non rivela nulla sugli UID senza la chiave.
+ *          Non supporta la rimozione: va ricostruito quando uno slot viene sostituito.
+ */
+template <uint16_t Bits, uint8_t Hashes>
+class TagBloomFilter {
+private:
+    static_assert(Bits >= 8 && Hashes > 0, "Dimensioni del filtro non valide");
+
+    uint8_t bits[(Bits + 7) / 8];
+
+    static uint16_t position(uint32_t fingerprint, uint8_t i) {
+        uint16_t h1 = fingerprint & 0xFFFF;
+        uint16_t h2 = (fingerprint >> 16) | 1;
+        return (h1 + (uint32_t)i * h2) % Bits;
+    }
+
+public:
+    TagBloomFilter() { clear(); }
+
+    void clear() { memset(bits, 0, sizeof(bits)); }
+
+    void add(uint32_t fingerprint) {
+        for (uint8_t i = 0; i < Hashes; i++) {
+            uint16_t bit = position(fingerprint, i);
+            bits[bit >> 3] |= (1 << (bit & 7));
+        }
+    }
+
+    /**
+     * @return false se l'impronta non è sicuramente presente, true se potrebbe esserlo
+     */
+    bool mayContain(uint32_t fingerprint) const {
+        for (uint8_t i = 0; i < Hashes; i++) {
+            uint16_t bit = position(fingerprint, i);
+            if (!(bits[bit >> 3] & (1 << (bit & 7)))) return false;
+        }
+        return true;
+    }
+};
+
+// Contatori del filtro negativo
+struct TagFilterStats {
+    uint32_t lookups;        // Verifiche totali
+    uint32_t rejects;        // UID scartati dal filtro senza consultare l'indice
+    uint32_t falsePositives; // UID passati dal filtro ma assenti in cache
+    uint32_t rebuilds;       // Ricostruzioni dopo una sostituzione
+    uint32_t missMicros;     // Costo medio (EWMA) di una ricerca fallita, misurato sui falsi positivi
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef TAP_METRICS_H
+#define TAP_METRICS_H
+
+#include <Arduino.h>
+
+// Fasi misurate di una lettura
+enum TapStage : uint8_t {
+    TAP_STAGE_READ,       // Lettura della risposta del PN532 (pollTags con esito)
+    TAP_STAGE_CACHE,      // SecureTagCache::verifyTag
+    TAP_STAGE_SEAL,       // Cifratura e MAC del messaggio
+    TAP_STAGE_PUBLISH,    // Pubblicazione MQTT (beginMessage .. endMessage)
+    TAP_STAGE_DECISION,   // Dal tag letto alla decisione locale (accessi dalla cache)
+    TAP_STAGE_SERVER,     // Andata e ritorno di nfc/verify
+    TAP_STAGE_COUNT
+};
+
+// Intervalli dell'istogramma: l'intervallo i conta le durate in [2^i, 2^(i+1)) µs,
+// l'ultimo anche quelle oltre (24 intervalli: fino a circa 16 s)
+#define TAP_METRICS_BUCKETS 24
+
+// Versione del formato di nfc/metrics
+#define TAP_METRICS_VERSION 1
+// Byte massimi di un messaggio: versione || fase || primo intervallo || intervalli || max (4) || conteggi (2 ciascuno)
+#define TAP_METRICS_PAYLOAD_MAX (8 + 2 * TAP_METRICS_BUCKETS)
+
+/**
+ * @brief Istogrammi delle durate di ogni fase di una lettura
+ * @details Ogni campione costa un conteggio del bit più alto e un
+ *          incremento: niente ordinamenti né campioni conservati. Gli
+ *          istogrammi coprono l'intervallo dall'ultimo reset(); i
+ *          conteggi da 16 bit si fermano al massimo invece di ricominciare.
+ *          I percentili restituiti sono il limite superiore dell'intervallo
+ *          che li contiene, quindi sovrastimano al più di un fattore 2.
+ */
+class TapMetrics {
+private:
+    uint16_t buckets[TAP_STAGE_COUNT][TAP_METRICS_BUCKETS];
+    uint32_t samples[TAP_STAGE_COUNT];
+    uint32_t maxUs[TAP_STAGE_COUNT];
+
+public:
+    TapMetrics() { reset(); }
+
+    static uint8_t bucketOf(uint32_t us) {
+        uint8_t b = 0;
+        while (us > 1 && b < TAP_METRICS_BUCKETS - 1) {
+            us >>= 1;
+            b++;
+        }
+        return b;
+    }
+
+    /**
+     * @brief Limite superiore (escluso) dell'intervallo in µs
+     */
+    static uint32_t bucketLimit(uint8_t bucket) {
+        return bucket >= 31 ? 0xFFFFFFFFUL : (1UL << (bucket + 1));
+    }
+
+    void record(TapStage stage, uint32_t us) {
+        if (stage >= TAP_STAGE_COUNT) return;
+        uint16_t& count = buckets[stage][bucketOf(us)];
+        if (count != 0xFFFF) count++;
+        samples[stage]++;
+        if (us > maxUs[stage]) maxUs[stage] = us;
+    }
+
+    void reset() {
+        memset(buckets, 0, sizeof(buckets));
+        memset(samples, 0, sizeof(samples));
+        memset(maxUs, 0, sizeof(maxUs));
+    }
+
+    uint32_t count(TapStage stage) const { return samples[stage]; }
+    uint32_t maximum(TapStage stage) const { return maxUs[stage]; }
+
+    /**
+     * @brief Percentile della fase
+     * @param percent Da 1 a 100
+     * @return Limite superiore dell'intervallo che contiene il percentile (µs), 0 senza campioni
+     */
+    uint32_t percentile(TapStage stage, uint8_t percent) const {
+        uint32_t total = 0;
+        for (uint8_t b = 0; b < TAP_METRICS_BUCKETS; b++) total += buckets[stage][b];
+        if (total == 0) return 0;
+
+        uint32_t rank = (total * percent + 99) / 100;
+        uint32_t seen = 0;
+        for (uint8_t b = 0; b < TAP_METRICS_BUCKETS; b++) {
+            seen += buckets[stage][b];
+            if (seen >= rank) return bucketLimit(b);
+        }
+        return bucketLimit(TAP_METRICS_BUCKETS - 1);
+    }
+
+    /**
+     * @brief Scrive l'istogramma di una fase nel formato di nfc/metrics
+     * @param out Buffer di almeno TAP_METRICS_PAYLOAD_MAX byte
+     * @return Byte scritti, 0 se la fase non ha campioni
+     * @details Solo gli intervalli dal primo all'ultimo non vuoto:
+     *          versione || fase || primo || numero || max µs (4 LE) || conteggi (2 LE)
+     */
+    size_t encode(TapStage stage, uint8_t* out) const {
+        int8_t first = -1, last = -1;
+        for (uint8_t b = 0; b < TAP_METRICS_BUCKETS; b++) {
+            if (buckets[stage][b] == 0) continue;
+            if (first < 0) first = b;
+            last = b;
+        }
+        if (first < 0) return 0;
+
+        uint8_t n = last - first + 1;
+        out[0] = TAP_METRICS_VERSION;
+        out[1] = stage;
+        out[2] = first;
+        out[3] = n;
+        for (uint8_t i = 0; i < 4; i++) out[4 + i] = (uint8_t)(maxUs[stage] >> (8 * i));
+        size_t len = 8;
+        for (uint8_t b = first; b <= last; b++) {
+            out[len++] = buckets[stage][b] & 0xFF;
+            out[len++] = buckets[stage][b] >> 8;
+        }
+        return len;
+    }
+
+    void printStats(Print& out) const {
+        static const char* const NAMES[TAP_STAGE_COUNT] = {
+            "lettura", "cache", "cifratura", "pubblicazione", "decisione", "server"
+        };
+        for (uint8_t s = 0; s < TAP_STAGE_COUNT; s++) {
+            TapStage stage = (TapStage)s;
+            if (samples[s] == 0) continue;
+            out.print("[METRICS] ");
+            out.print(NAMES[s]);
+            out.print(": campioni ");
+            out.print((unsigned long)samples[s]);
+            out.print(", p50 < ");
+            out.print((unsigned long)percentile(stage, 50));
+            out.print(" us, p99 < ");
+            out.print((unsigned long)percentile(stage, 99));
+            out.print(" us, max ");
+            out.print((unsigned long)maxUs[s]);
+            out.println(" us");
+        }
+    }
+};
+
+#endif
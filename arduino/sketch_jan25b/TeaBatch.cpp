@@ -0,0 +1,264 @@
+#include "TeaBatch.h"
+#include "TeaCore.h"
+
+#if TEA_BATCH_X86
+#include <immintrin.h>
+#endif
+
+// Blocchi elaborati insieme dal percorso scalare
+static const size_t SCALAR_LANES = 4;
+
+/**
+ * @brief Carica le parole dei blocchi di un gruppo di corsie
+ * @param lanes Blocchi presenti; le corsie successive fino a width sono azzerate
+ */
+static void loadBlocks(const uint8_t* blocks, size_t lanes, size_t width, uint32_t* v0, uint32_t* v1) {
+    for (size_t l = 0; l < width; l++) {
+        if (l < lanes) {
+            memcpy(&v0[l], blocks + l * 8, 4);
+            memcpy(&v1[l], blocks + l * 8 + 4, 4);
+        } else {
+            v0[l] = v1[l] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Traspone le chiavi di un gruppo: k[i][l] è la parola i della chiave della corsia l
+ */
+static void loadKeys(const uint8_t* keys, size_t keyStride, size_t lanes, size_t width, uint32_t (*k)[8]) {
+    for (size_t l = 0; l < width; l++) {
+        for (uint8_t i = 0; i < 4; i++) {
+            if (l < lanes) memcpy(&k[i][l], keys + l * keyStride + i * 4, 4);
+            else k[i][l] = 0;
+        }
+    }
+}
+
+static void storeBlocks(uint8_t* blocks, size_t lanes, const uint32_t* v0, const uint32_t* v1) {
+    for (size_t l = 0; l < lanes; l++) {
+        memcpy(blocks + l * 8, &v0[l], 4);
+        memcpy(blocks + l * 8 + 4, &v1[l], 4);
+    }
+}
+
+/**
+ * @brief Percorso portabile: SCALAR_LANES blocchi interlacciati round per round
+ * @details Le catene di dipendenza dei blocchi sono indipendenti, quindi la
+ *          CPU (o il compilatore) può sovrapporle
+ */
+template <bool Decrypt>
+static void scalarBatch(uint8_t* blocks, size_t count, const uint8_t* keys, size_t keyStride,
+                        uint8_t rounds) {
+    uint32_t v0[SCALAR_LANES], v1[SCALAR_LANES], k[4][8];
+
+    for (size_t done = 0; done < count; done += SCALAR_LANES) {
+        size_t lanes = count - done < SCALAR_LANES ? count - done : SCALAR_LANES;
+        loadBlocks(blocks + done * 8, lanes, SCALAR_LANES, v0, v1);
+        // Con chiave condivisa (keyStride 0) ogni corsia legge la stessa chiave
+        loadKeys(keys + done * keyStride, keyStride, lanes, SCALAR_LANES, k);
+
+        uint32_t sum = Decrypt ? TEA_DELTA * rounds : 0;
+        for (uint8_t r = 0; r < rounds; r++) {
+            if (!Decrypt) sum += TEA_DELTA;
+            for (size_t l = 0; l < SCALAR_LANES; l++) {
+                if (Decrypt) {
+                    v1[l] -= ((v0[l] << 4) + k[2][l]) ^ (v0[l] + sum) ^ ((v0[l] >> 5) + k[3][l]);
+                    v0[l] -= ((v1[l] << 4) + k[0][l]) ^ (v1[l] + sum) ^ ((v1[l] >> 5) + k[1][l]);
+                } else {
+                    v0[l] += ((v1[l] << 4) + k[0][l]) ^ (v1[l] + sum) ^ ((v1[l] >> 5) + k[1][l]);
+                    v1[l] += ((v0[l] << 4) + k[2][l]) ^ (v0[l] + sum) ^ ((v0[l] >> 5) + k[3][l]);
+                }
+            }
+            if (Decrypt) sum -= TEA_DELTA;
+        }
+
+        storeBlocks(blocks + done * 8, lanes, v0, v1);
+    }
+}
+
+#if TEA_BATCH_X86
+
+// Mezzo round TEA su un vettore di corsie: ((y << 4) + ka) ^ (y + sum) ^ ((y >> 5) + kb)
+__attribute__((target("sse2")))
+static inline __m128i teaMix(__m128i y, __m128i ka, __m128i kb, __m128i sum) {
+    return _mm_xor_si128(_mm_xor_si128(_mm_add_epi32(_mm_slli_epi32(y, 4), ka), _mm_add_epi32(y, sum)),
+                         _mm_add_epi32(_mm_srli_epi32(y, 5), kb));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i teaMix(__m256i y, __m256i ka, __m256i kb, __m256i sum) {
+    return _mm256_xor_si256(_mm256_xor_si256(_mm256_add_epi32(_mm256_slli_epi32(y, 4), ka), _mm256_add_epi32(y, sum)),
+                            _mm256_add_epi32(_mm256_srli_epi32(y, 5), kb));
+}
+
+/**
+ * @brief Percorso SSE2: 4 blocchi per registro
+ * @details I blocchi [v0 v1] vengono separati in un registro di v0 e uno di v1
+ *          e ricomposti alla fine; le chiavi per blocco sono trasposte per corsia
+ */
+template <bool Decrypt>
+__attribute__((target("sse2")))
+static void sse2Batch(uint8_t* blocks, size_t count, const uint8_t* keys, size_t keyStride,
+                      uint8_t rounds) {
+    const size_t LANES = 4;
+    uint32_t lv0[LANES], lv1[LANES], lk[4][8];
+    __m128i k[4] = {};
+
+    if (keyStride == 0) {
+        loadKeys(keys, 0, 1, 1, lk);
+        for (uint8_t i = 0; i < 4; i++) k[i] = _mm_set1_epi32((int)lk[i][0]);
+    }
+
+    for (size_t done = 0; done < count; done += LANES) {
+        size_t lanes = count - done < LANES ? count - done : LANES;
+        uint8_t* group = blocks + done * 8;
+        __m128i v0, v1;
+
+        if (lanes == LANES) {
+            __m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)group), 0xD8);
+            __m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(group + 16)), 0xD8);
+            v0 = _mm_unpacklo_epi64(a, b);
+            v1 = _mm_unpackhi_epi64(a, b);
+        } else {
+            loadBlocks(group, lanes, LANES, lv0, lv1);
+            v0 = _mm_loadu_si128((const __m128i*)lv0);
+            v1 = _mm_loadu_si128((const __m128i*)lv1);
+        }
+        if (keyStride != 0) {
+            loadKeys(keys + done * keyStride, keyStride, lanes, LANES, lk);
+            for (uint8_t i = 0; i < 4; i++) k[i] = _mm_loadu_si128((const __m128i*)lk[i]);
+        }
+
+        uint32_t s = Decrypt ? TEA_DELTA * rounds : 0;
+        for (uint8_t r = 0; r < rounds; r++) {
+            if (!Decrypt) s += TEA_DELTA;
+            __m128i sum = _mm_set1_epi32((int)s);
+            if (Decrypt) {
+                v1 = _mm_sub_epi32(v1, teaMix(v0, k[2], k[3], sum));
+                v0 = _mm_sub_epi32(v0, teaMix(v1, k[0], k[1], sum));
+                s -= TEA_DELTA;
+            } else {
+                v0 = _mm_add_epi32(v0, teaMix(v1, k[0], k[1], sum));
+                v1 = _mm_add_epi32(v1, teaMix(v0, k[2], k[3], sum));
+            }
+        }
+
+        if (lanes == LANES) {
+            _mm_storeu_si128((__m128i*)group, _mm_unpacklo_epi32(v0, v1));
+            _mm_storeu_si128((__m128i*)(group + 16), _mm_unpackhi_epi32(v0, v1));
+        } else {
+            _mm_storeu_si128((__m128i*)lv0, v0);
+            _mm_storeu_si128((__m128i*)lv1, v1);
+            storeBlocks(group, lanes, lv0, lv1);
+        }
+    }
+}
+
+/**
+ * @brief Percorso AVX2: 8 blocchi per registro
+ * @details Come sse2Batch(); la permutazione delle parole da 64 bit riporta
+ *          le corsie nell'ordine dei blocchi dopo la separazione per metà registro
+ */
+template <bool Decrypt>
+__attribute__((target("avx2")))
+static void avx2Batch(uint8_t* blocks, size_t count, const uint8_t* keys, size_t keyStride,
+                      uint8_t rounds) {
+    const size_t LANES = 8;
+    uint32_t lv0[LANES], lv1[LANES], lk[4][8];
+    __m256i k[4] = {};
+
+    if (keyStride == 0) {
+        loadKeys(keys, 0, 1, 1, lk);
+        for (uint8_t i = 0; i < 4; i++) k[i] = _mm256_set1_epi32((int)lk[i][0]);
+    }
+
+    for (size_t done = 0; done < count; done += LANES) {
+        size_t lanes = count - done < LANES ? count - done : LANES;
+        uint8_t* group = blocks + done * 8;
+        __m256i v0, v1;
+
+        if (lanes == LANES) {
+            __m256i a = _mm256_shuffle_epi32(_mm256_loadu_si256((const __m256i*)group), 0xD8);
+            __m256i b = _mm256_shuffle_epi32(_mm256_loadu_si256((const __m256i*)(group + 32)), 0xD8);
+            v0 = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+            v1 = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+        } else {
+            loadBlocks(group, lanes, LANES, lv0, lv1);
+            v0 = _mm256_loadu_si256((const __m256i*)lv0);
+            v1 = _mm256_loadu_si256((const __m256i*)lv1);
+        }
+        if (keyStride != 0) {
+            loadKeys(keys + done * keyStride, keyStride, lanes, LANES, lk);
+            for (uint8_t i = 0; i < 4; i++) k[i] = _mm256_loadu_si256((const __m256i*)lk[i]);
+        }
+
+        uint32_t s = Decrypt ? TEA_DELTA * rounds : 0;
+        for (uint8_t r = 0; r < rounds; r++) {
+            if (!Decrypt) s += TEA_DELTA;
+            __m256i sum = _mm256_set1_epi32((int)s);
+            if (Decrypt) {
+                v1 = _mm256_sub_epi32(v1, teaMix(v0, k[2], k[3], sum));
+                v0 = _mm256_sub_epi32(v0, teaMix(v1, k[0], k[1], sum));
+                s -= TEA_DELTA;
+            } else {
+                v0 = _mm256_add_epi32(v0, teaMix(v1, k[0], k[1], sum));
+                v1 = _mm256_add_epi32(v1, teaMix(v0, k[2], k[3], sum));
+            }
+        }
+
+        if (lanes == LANES) {
+            __m256i lo = _mm256_unpacklo_epi32(v0, v1);
+            __m256i hi = _mm256_unpackhi_epi32(v0, v1);
+            _mm256_storeu_si256((__m256i*)group, _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i*)(group + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+        } else {
+            _mm256_storeu_si256((__m256i*)lv0, v0);
+            _mm256_storeu_si256((__m256i*)lv1, v1);
+            storeBlocks(group, lanes, lv0, lv1);
+        }
+    }
+}
+
+#endif
+
+bool teaBatchSupported(TeaBatchPath path) {
+    switch (path) {
+        case TEA_BATCH_SCALAR: return true;
+#if TEA_BATCH_X86
+        case TEA_BATCH_SSE2: return __builtin_cpu_supports("sse2");
+        case TEA_BATCH_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+TeaBatchPath teaBatchBestPath() {
+    static TeaBatchPath best = teaBatchSupported(TEA_BATCH_AVX2) ? TEA_BATCH_AVX2
+                             : teaBatchSupported(TEA_BATCH_SSE2) ? TEA_BATCH_SSE2
+                             : TEA_BATCH_SCALAR;
+    return best;
+}
+
+template <bool Decrypt>
+static void teaBatch(uint8_t* blocks, size_t count, const uint8_t* keys, size_t keyStride,
+                     uint8_t rounds, TeaBatchPath path) {
+    if (!teaBatchSupported(path)) path = TEA_BATCH_SCALAR;
+    switch (path) {
+#if TEA_BATCH_X86
+        case TEA_BATCH_AVX2: avx2Batch<Decrypt>(blocks, count, keys, keyStride, rounds); return;
+        case TEA_BATCH_SSE2: sse2Batch<Decrypt>(blocks, count, keys, keyStride, rounds); return;
+#endif
+        default: scalarBatch<Decrypt>(blocks, count, keys, keyStride, rounds); return;
+    }
+}
+
+void teaBatchEncrypt(uint8_t* blocks, size_t count, const uint8_t* keys, size_t keyStride,
+                     uint8_t rounds, TeaBatchPath path) {
+    teaBatch<false>(blocks, count, keys, keyStride, rounds, path);
+}
+
+void teaBatchDecrypt(uint8_t* blocks, size_t count, const uint8_t* keys, size_t keyStride,
+                     uint8_t rounds, TeaBatchPath path) {
+    teaBatch<true>(blocks, count, keys, keyStride, rounds, path);
+}
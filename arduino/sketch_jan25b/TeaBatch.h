@@ -0,0 +1,52 @@
+#ifndef TEA_BATCH_H
+#define TEA_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Percorsi SIMD disponibili solo su host x86 con GCC/Clang
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TEA_BATCH_X86 1
+#else
+#define TEA_BATCH_X86 0
+#endif
+
+// Implementazione usata per un lotto di blocchi
+enum TeaBatchPath : uint8_t {
+    TEA_BATCH_SCALAR,  // 4 blocchi interlacciati, portabile (anche Arduino)
+    TEA_BATCH_SSE2,    // 4 blocchi per registro a 128 bit
+    TEA_BATCH_AVX2     // 8 blocchi per registro a 256 bit
+};
+
+/**
+ * @brief Percorso più veloce supportato dalla CPU corrente
+ * @details Determinato al primo utilizzo; su Arduino è sempre TEA_BATCH_SCALAR
+ */
+TeaBatchPath teaBatchBestPath();
+
+/**
+ * @brief Indica se un percorso è utilizzabile sulla CPU corrente
+ */
+bool teaBatchSupported(TeaBatchPath path);
+
+/**
+ * @brief Cifra in place count blocchi TEA indipendenti (ECB)
+ * @param blocks Blocchi da 8 byte consecutivi
+ * @param count Numero di blocchi
+ * @param keys Chiavi da 16 byte
+ * @param keyStride Distanza in byte tra le chiavi: 0 = stessa chiave per tutti, 16 = una per blocco
+ * @param rounds Numero di cicli TEA
+ * @param path Implementazione da usare; se non supportata si usa quella scalare
+ * @details Il risultato è identico bit per bit a LightweightCrypto::encrypt()
+ */
+void teaBatchEncrypt(uint8_t* blocks, size_t count, const uint8_t* keys, size_t keyStride,
+                     uint8_t rounds, TeaBatchPath path);
+
+/**
+ * @brief Decifra in place count blocchi TEA indipendenti (ECB)
+ * @details Parametri come teaBatchEncrypt()
+ */
+void teaBatchDecrypt(uint8_t* blocks, size_t count, const uint8_t* keys, size_t keyStride,
+                     uint8_t rounds, TeaBatchPath path);
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef TEA_CORE_H
+#define TEA_CORE_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Srotolamento completo dei round: attivo dove la flash lo consente
+// (ARM, host), disattivato su AVR dove 32 round srotolati costano troppo
+#ifndef TEA_UNROLL
+#if defined(__AVR__)
+#define TEA_UNROLL 0
+#else
+#define TEA_UNROLL 1
+#endif
+#endif
+
+#define TEA_INLINE inline __attribute__((always_inline))
+
+static constexpr uint32_t TEA_DELTA = 0x9E3779B9;
+
+// Round TEA con somma nota a tempo di compilazione (versione srotolata)
+template <uint8_t Round, uint8_t Rounds>
+struct TeaUnrolled {
+    static constexpr uint32_t SUM = TEA_DELTA * (uint32_t)Round;
+
+    static TEA_INLINE void encrypt(uint32_t& v0, uint32_t& v1, const uint32_t* k) {
+        v0 += ((v1 << 4) + k[0]) ^ (v1 + SUM) ^ ((v1 >> 5) + k[1]);
+        v1 += ((v0 << 4) + k[2]) ^ (v0 + SUM) ^ ((v0 >> 5) + k[3]);
+        TeaUnrolled<Round + 1, Rounds>::encrypt(v0, v1, k);
+    }
+
+    static TEA_INLINE void decrypt(uint32_t& v0, uint32_t& v1, const uint32_t* k) {
+        TeaUnrolled<Round + 1, Rounds>::decrypt(v0, v1, k);
+        v1 -= ((v0 << 4) + k[2]) ^ (v0 + SUM) ^ ((v0 >> 5) + k[3]);
+        v0 -= ((v1 << 4) + k[0]) ^ (v1 + SUM) ^ ((v1 >> 5) + k[1]);
+    }
+};
+
+template <uint8_t Rounds>
+struct TeaUnrolled<Rounds + 1, Rounds> {
+    static TEA_INLINE void encrypt(uint32_t&, uint32_t&, const uint32_t*) {}
+    static TEA_INLINE void decrypt(uint32_t&, uint32_t&, const uint32_t*) {}
+};
+
+/**
+ * @brief Cifrario TEA con chiave già scompattata in parole da 32 bit
+ * @tparam Rounds Numero di cicli (32 nel TEA standard e nel server)
+ * @tparam Unroll Round srotolati, con le somme come costanti di compilazione
+ * @details setKey() converte la chiave una sola volta: i blocchi successivi
+ *          non copiano più la chiave.
+ */
+template <uint8_t Rounds, bool Unroll = TEA_UNROLL>
+class TeaCore {
+private:
+    uint32_t k[4];
+
+public:
+    void setKey(const uint8_t keyBytes[16]) { memcpy(k, keyBytes, 16); }
+    void clear() { memset(k, 0, sizeof(k)); }
+
+    TEA_INLINE void encryptWords(uint32_t& v0, uint32_t& v1) const {
+        if (Unroll) {
+            TeaUnrolled<1, Rounds>::encrypt(v0, v1, k);
+            return;
+        }
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < Rounds; i++) {
+            sum += TEA_DELTA;
+            v0 += ((v1 << 4) + k[0]) ^ (v1 + sum) ^ ((v1 >> 5) + k[1]);
+            v1 += ((v0 << 4) + k[2]) ^ (v0 + sum) ^ ((v0 >> 5) + k[3]);
+        }
+    }
+
+    TEA_INLINE void decryptWords(uint32_t& v0, uint32_t& v1) const {
+        if (Unroll) {
+            TeaUnrolled<1, Rounds>::decrypt(v0, v1, k);
+            return;
+        }
+        uint32_t sum = TEA_DELTA * Rounds;
+        for (uint8_t i = 0; i < Rounds; i++) {
+            v1 -= ((v0 << 4) + k[2]) ^ (v0 + sum) ^ ((v0 >> 5) + k[3]);
+            v0 -= ((v1 << 4) + k[0]) ^ (v1 + sum) ^ ((v1 >> 5) + k[1]);
+            sum -= TEA_DELTA;
+        }
+    }
+
+    void encryptBlock(uint8_t* block) const {
+        uint32_t v0, v1;
+        memcpy(&v0, block, 4);
+        memcpy(&v1, block + 4, 4);
+        encryptWords(v0, v1);
+        memcpy(block, &v0, 4);
+        memcpy(block + 4, &v1, 4);
+    }
+
+    void decryptBlock(uint8_t* block) const {
+        uint32_t v0, v1;
+        memcpy(&v0, block, 4);
+        memcpy(&v1, block + 4, 4);
+        decryptWords(v0, v1);
+        memcpy(block, &v0, 4);
+        memcpy(block + 4, &v1, 4);
+    }
+};
+
+/**
+ * @brief Cifrario XTEA con key schedule precalcolato
+ * @tparam Rounds Numero di cicli (32 nello standard, ogni ciclo è di due mezzi round)
+ * @details In setKey() vengono precalcolate le sottochiavi sum + k[indice]
+ *          di ogni mezzo round: la cifratura non calcola più gli indici della chiave.
+ */
+template <uint8_t Rounds>
+class XteaCore {
+private:
+    uint32_t schedule[2 * Rounds];
+
+public:
+    void setKey(const uint8_t keyBytes[16]) {
+        uint32_t k[4];
+        memcpy(k, keyBytes, 16);
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < Rounds; i++) {
+            schedule[2 * i] = sum + k[sum & 3];
+            sum += TEA_DELTA;
+            schedule[2 * i + 1] = sum + k[(sum >> 11) & 3];
+        }
+        memset(k, 0, sizeof(k));
+    }
+
+    void clear() { memset(schedule, 0, sizeof(schedule)); }
+
+    TEA_INLINE void encryptWords(uint32_t& v0, uint32_t& v1) const {
+#if TEA_UNROLL
+#pragma GCC unroll 64
+#endif
+        for (uint8_t i = 0; i < Rounds; i++) {
+            v0 += (((v1 << 4) ^ (v1 >> 5)) + v1) ^ schedule[2 * i];
+            v1 += (((v0 << 4) ^ (v0 >> 5)) + v0) ^ schedule[2 * i + 1];
+        }
+    }
+
+    TEA_INLINE void decryptWords(uint32_t& v0, uint32_t& v1) const {
+#if TEA_UNROLL
+#pragma GCC unroll 64
+#endif
+        for (uint8_t i = Rounds; i > 0; i--) {
+            v1 -= (((v0 << 4) ^ (v0 >> 5)) + v0) ^ schedule[2 * i - 1];
+            v0 -= (((v1 << 4) ^ (v1 >> 5)) + v1) ^ schedule[2 * i - 2];
+        }
+    }
+
+    void encryptBlock(uint8_t* block) const {
+        uint32_t v0, v1;
+        memcpy(&v0, block, 4);
+        memcpy(&v1, block + 4, 4);
+        encryptWords(v0, v1);
+        memcpy(block, &v0, 4);
+        memcpy(block + 4, &v1, 4);
+    }
+
+    void decryptBlock(uint8_t* block) const {
+        uint32_t v0, v1;
+        memcpy(&v0, block, 4);
+        memcpy(&v1, block + 4, 4);
+        decryptWords(v0, v1);
+        memcpy(block, &v0, 4);
+        memcpy(block + 4, &v1, 4);
+    }
+};
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef VERDICT_CACHE_H
+#define VERDICT_CACHE_H
+
+#include <Arduino.h>
+
+// Esito memorizzato per un UID
+#define VERDICT_NONE    0   // Nessun esito valido: chiedere al server
+#define VERDICT_GRANTED 1
+#define VERDICT_DENIED  2
+
+// Byte dell'impronta di un UID (MAC troncato)
+#define VERDICT_TAG_LEN 8
+
+// Esito firmato dal server, valido fino alla scadenza
+struct CachedVerdict {
+    uint8_t tag[VERDICT_TAG_LEN];   // Impronta dell'UID, mai l'UID in chiaro
+    uint8_t verdict;                // VERDICT_*, VERDICT_NONE = voce libera
+    uint32_t expires;               // millis() oltre il quale la voce non vale più
+};
+
+// Contatori della cache degli esiti
+struct VerdictCacheStats {
+    uint32_t granted;     // Tap concessi senza chiedere al server
+    uint32_t denied;      // Tap rifiutati senza chiedere al server
+    uint32_t stored;      // Esiti memorizzati
+    uint32_t expired;     // Voci scadute al momento della ricerca
+};
+
+/**
+ * @brief Esiti recenti delle verifiche remote
+ * @tparam Capacity Esiti memorizzati contemporaneamente
+ * @details Tiene gli esiti firmati del server per la durata indicata nella
+ *          risposta: i tap ripetuti di un badge autorizzato dal server sono
+ *          decisi in locale e quelli di un badge sconosciuto non costano una
+ *          nuova richiesta. Solo in RAM: dopo un riavvio si richiede di nuovo
+ *          al server. Le voci sono indicizzate dall'impronta dell'UID,
+ *          calcolata dal chiamante con la chiave del dispositivo. A tabella
+ *          piena si sostituisce la voce che scade per prima.
+ */
+template <uint8_t Capacity>
+class VerdictCache {
+private:
+    static_assert(Capacity > 0, "Dimensione della tabella non valida");
+
+    CachedVerdict entries[Capacity];
+    VerdictCacheStats counters;
+
+    static bool reached(uint32_t now, uint32_t deadline) {
+        return (int32_t)(now - deadline) >= 0;
+    }
+
+public:
+    VerdictCache() { clear(); }
+
+    void clear() {
+        memset(entries, 0, sizeof(entries));
+        memset(&counters, 0, sizeof(counters));
+    }
+
+    /**
+     * @brief Cerca l'esito di un UID
+     * @param tag Impronta dell'UID (VERDICT_TAG_LEN byte)
+     * @param now millis() attuale
+     * @return VERDICT_GRANTED, VERDICT_DENIED o VERDICT_NONE se assente o scaduto
+     */
+    uint8_t lookup(const uint8_t* tag, uint32_t now) {
+        for (uint8_t i = 0; i < Capacity; i++) {
+            CachedVerdict& entry = entries[i];
+            if (entry.verdict == VERDICT_NONE || memcmp(entry.tag, tag, VERDICT_TAG_LEN) != 0) continue;
+            if (reached(now, entry.expires)) {
+                memset(&entry, 0, sizeof(entry));
+                counters.expired++;
+                return VERDICT_NONE;
+            }
+            if (entry.verdict == VERDICT_GRANTED) counters.granted++;
+            else counters.denied++;
+            return entry.verdict;
+        }
+        return VERDICT_NONE;
+    }
+
+    /**
+     * @brief Memorizza l'esito di una verifica remota
+     * @param tag Impronta dell'UID
+     * @param verdict VERDICT_GRANTED o VERDICT_DENIED
+     * @param now millis() alla ricezione
+     * @param ttlMs Validità dell'esito, 0 per non memorizzarlo
+     */
+    void store(const uint8_t* tag, uint8_t verdict, uint32_t now, uint32_t ttlMs) {
+        if (ttlMs == 0 || verdict == VERDICT_NONE) return;
+
+        // Stessa impronta, altrimenti voce libera o scaduta, altrimenti la prima a scadere
+        int8_t slot = -1;
+        for (uint8_t i = 0; i < Capacity; i++) {
+            const CachedVerdict& entry = entries[i];
+            if (entry.verdict != VERDICT_NONE && memcmp(entry.tag, tag, VERDICT_TAG_LEN) == 0) {
+                slot = i;
+                break;
+            }
+            bool free = entry.verdict == VERDICT_NONE || reached(now, entry.expires);
+            bool slotFree = slot >= 0 && (entries[slot].verdict == VERDICT_NONE || reached(now, entries[slot].expires));
+            if (slot < 0 || (free && !slotFree) ||
+                (!free && !slotFree && (int32_t)(entry.expires - entries[slot].expires) < 0)) {
+                slot = i;
+            }
+        }
+
+        CachedVerdict& entry = entries[slot];
+        memcpy(entry.tag, tag, VERDICT_TAG_LEN);
+        entry.verdict = verdict;
+        entry.expires = now + ttlMs;
+        counters.stored++;
+    }
+
+    uint8_t size(uint32_t now) const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < Capacity; i++) {
+            if (entries[i].verdict != VERDICT_NONE && !reached(now, entries[i].expires)) n++;
+        }
+        return n;
+    }
+
+    const VerdictCacheStats& stats() const { return counters; }
+
+    void printStats(Print& out) const {
+        out.print("[VERDICT] Concessi: ");
+        out.print((unsigned long)counters.granted);
+        out.print(", rifiutati: ");
+        out.print((unsigned long)counters.denied);
+        out.print(", memorizzati: ");
+        out.print((unsigned long)counters.stored);
+        out.print(", scaduti: ");
+        out.println((unsigned long)counters.expired);
+    }
+};
+
+#endif
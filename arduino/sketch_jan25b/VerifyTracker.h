@@ -0,0 +1,187 @@
+#ifndef VERIFY_TRACKER_H
+#define VERIFY_TRACKER_H
+
+#include <Arduino.h>
+
+// Contatori delle verifiche remote
+struct VerifyStats {
+    uint32_t sent;        // Richieste inviate al server
+    uint32_t answered;    // Risposte associate a una richiesta in attesa
+    uint32_t timeouts;    // Richieste scadute, decise dalla politica locale
+    uint32_t overflows;   // Tap decisi in locale perché la tabella era piena
+    uint32_t unmatched;   // Risposte senza richiesta in attesa (tardive o duplicate)
+    uint32_t rttLast;     // Tempo di risposta dell'ultima verifica (ms)
+    uint32_t rttMin;
+    uint32_t rttMax;
+    uint32_t rttSum;      // Somma dei tempi di risposta, per la media
+};
+
+// Verifica remota in attesa di risposta
+struct PendingVerify {
+    uint16_t id;          // ID della richiesta, 0 = voce libera
+    uint32_t sentAt;      // millis() all'invio
+    uint32_t deadline;    // millis() oltre il quale si applica la politica locale
+    uint8_t uid[7];
+    uint8_t uidLength;
+    uint8_t reader;       // Lettore che ha letto il tag
+};
+
+/**
+ * @brief Tabella delle verifiche remote in corso
+ * @tparam Capacity Verifiche in attesa contemporaneamente
+ * @details Ogni richiesta su nfc/verify riceve un ID diverso da zero e una
+ *          scadenza propria; la risposta del server riporta l'ID e viene
+ *          associata alla richiesta giusta anche se più tap sono in corso o
+ *          le risposte arrivano in ordine diverso. Le richieste senza
+ *          risposta entro la scadenza vengono restituite da expire().
+ *          Nessuna allocazione: le voci sono in un array fisso.
+ */
+template <uint8_t Capacity>
+class VerifyTracker {
+private:
+    static_assert(Capacity > 0, "Dimensione della tabella non valida");
+
+    PendingVerify entries[Capacity];
+    uint16_t nextId;
+    VerifyStats counters;
+
+    static bool reached(uint32_t now, uint32_t deadline) {
+        return (int32_t)(now - deadline) >= 0;
+    }
+
+public:
+    VerifyTracker() : nextId(1) {
+        memset(entries, 0, sizeof(entries));
+        memset(&counters, 0, sizeof(counters));
+    }
+
+    /**
+     * @brief Imposta il primo ID usato
+     * @details Con un valore casuale all'avvio le risposte tardive a
+     *          richieste precedenti a un riavvio non vengono associate
+     */
+    void seed(uint16_t first) {
+        nextId = first ? first : 1;
+    }
+
+    /**
+     * @brief Registra una nuova richiesta
+     * @param uid UID del tag (7 byte, completato con zeri)
+     * @param uidLength Byte significativi dell'UID
+     * @param reader Lettore che ha letto il tag
+     * @param now millis() all'invio
+     * @param timeout Attesa massima della risposta (ms)
+     * @return ID della richiesta, 0 se la tabella è piena
+     */
+    uint16_t add(const uint8_t* uid, uint8_t uidLength, uint8_t reader, uint32_t now, uint32_t timeout) {
+        for (uint8_t i = 0; i < Capacity; i++) {
+            PendingVerify& entry = entries[i];
+            if (entry.id != 0) continue;
+
+            entry.id = nextId;
+            if (++nextId == 0) nextId = 1;
+            entry.sentAt = now;
+            entry.deadline = now + timeout;
+            memcpy(entry.uid, uid, sizeof(entry.uid));
+            entry.uidLength = uidLength;
+            entry.reader = reader;
+            counters.sent++;
+            return entry.id;
+        }
+        counters.overflows++;
+        return 0;
+    }
+
+    /**
+     * @brief Richiesta in attesa con l'ID indicato, senza rimuoverla
+     * @return nullptr se nessuna richiesta ha quell'ID
+     */
+    const PendingVerify* find(uint16_t id) const {
+        for (uint8_t i = 0; i < Capacity; i++) {
+            if (id != 0 && entries[i].id == id) return &entries[i];
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Rimuove la richiesta a cui risponde il server
+     * @param id ID riportato nella risposta, 0 per la richiesta più vecchia
+     *        (broker che rispondono senza ID, in ordine di arrivo)
+     * @param now millis() alla ricezione
+     * @param out Riceve la richiesta rimossa
+     * @return true se la richiesta era in attesa
+     */
+    bool take(uint16_t id, uint32_t now, PendingVerify& out) {
+        int8_t found = -1;
+        for (uint8_t i = 0; i < Capacity; i++) {
+            if (entries[i].id == 0) continue;
+            if (id != 0 ? entries[i].id == id
+                        : found < 0 || (int32_t)(entries[i].sentAt - entries[found].sentAt) < 0) {
+                found = i;
+                if (id != 0) break;
+            }
+        }
+        if (found < 0) {
+            counters.unmatched++;
+            return false;
+        }
+
+        out = entries[found];
+        memset(&entries[found], 0, sizeof(PendingVerify));
+
+        uint32_t rtt = now - out.sentAt;
+        if (counters.answered == 0 || rtt < counters.rttMin) counters.rttMin = rtt;
+        if (rtt > counters.rttMax) counters.rttMax = rtt;
+        counters.rttLast = rtt;
+        counters.rttSum += rtt;
+        counters.answered++;
+        return true;
+    }
+
+    /**
+     * @brief Rimuove una richiesta scaduta
+     * @param now millis() attuale
+     * @param out Riceve la richiesta scaduta
+     * @return true se una richiesta è scaduta (chiamare finché restituisce true)
+     */
+    bool expire(uint32_t now, PendingVerify& out) {
+        for (uint8_t i = 0; i < Capacity; i++) {
+            if (entries[i].id == 0 || !reached(now, entries[i].deadline)) continue;
+            out = entries[i];
+            memset(&entries[i], 0, sizeof(PendingVerify));
+            counters.timeouts++;
+            return true;
+        }
+        return false;
+    }
+
+    uint8_t inFlight() const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < Capacity; i++) {
+            if (entries[i].id != 0) n++;
+        }
+        return n;
+    }
+
+    const VerifyStats& stats() const { return counters; }
+
+    void printStats(Print& out) const {
+        out.print("[VERIFY] Inviate: ");
+        out.print((unsigned long)counters.sent);
+        out.print(", risposte: ");
+        out.print((unsigned long)counters.answered);
+        out.print(", scadute: ");
+        out.print((unsigned long)counters.timeouts);
+        out.print(", tabella piena: ");
+        out.print((unsigned long)counters.overflows);
+        out.print(", RTT min/medio/max: ");
+        out.print((unsigned long)counters.rttMin);
+        out.print("/");
+        out.print((unsigned long)(counters.answered ? counters.rttSum / counters.answered : 0));
+        out.print("/");
+        out.print((unsigned long)counters.rttMax);
+        out.println(" ms");
+    }
+};
+
+#endif
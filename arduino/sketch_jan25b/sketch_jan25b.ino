@@ -1,16 +1,34 @@
 #include <WiFiS3.h>
 #include <ArduinoMqttClient.h>
+#include "config.h"
 #include "PN532.h"
 #include "NFCSecure.h"
-#include "config.h"
+#include "TagCacheStore.h"
+#include "Log.h"
 
 
 WiFiSSLClient wifiClient;
 MqttClient mqttClient(wifiClient);
 NFCReader nfc;
 SecureTagCache tagCache;
+TagCacheStore<SecureTagCache> tagStore(tagCache);
 NFCManager nfcManager(nfc, tagCache, mqttClient);
 
+// Riconnessione al broker: attesa che raddoppia a ogni tentativo fallito
+const unsigned long MQTT_RETRY_MIN_MS = 1000;
+const unsigned long MQTT_RETRY_MAX_MS = 60000;
+unsigned long mqttRetryDelay = MQTT_RETRY_MIN_MS;
+unsigned long mqttRetryAt = 0;
+// Durata massima di un tentativo: il loop (e la porta) restano fermi per tutto il tentativo
+const unsigned long MQTT_CONNECT_TIMEOUT_MS = 2000;
+const unsigned long WIFI_JOIN_TIMEOUT_MS = 500;
+// Tempo lasciato al modulo per completare l'accesso alla rete prima di un nuovo WiFi.begin()
+const unsigned long WIFI_JOIN_RETRY_MS = 20000;
+unsigned long wifiJoinAt = 0;
+bool wifiJoining = false;
+// false se l'area EEPROM non basta: la cache resta solo in RAM
+bool tagStoreEnabled = false;
+
 
 
 void setup() {
@@ -21,6 +39,7 @@ void setup() {
   Serial.println("\n=== NFCSecure System ===");
   
   // WiFi
+  WiFi.setTimeout(WIFI_JOIN_TIMEOUT_MS);
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
   while (WiFi.status() != WL_CONNECTED) {
     delay(500);
@@ -33,6 +52,7 @@ void setup() {
   // TLS
   Serial.println("\n[TLS] Inizializzazione...");
   wifiClient.setCACert(rootCACert);
+  wifiClient.setConnectionTimeout(MQTT_CONNECT_TIMEOUT_MS);
   Serial.println("[TLS] Certificati caricati");
 
   
@@ -51,7 +71,9 @@ void setup() {
     mqttClient.setId("device_" + String(random(0xffff), HEX));
     mqttClient.setUsernamePassword(encryptedMac, encryptedKey);
 
-  if (!mqttClient.connect(BROKER_ADDRESS, BROKER_PORT)) {
+  mqttClient.onMessage(onMessageReceived);
+  mqttClient.setConnectionTimeout(MQTT_CONNECT_TIMEOUT_MS);
+  if (!connectMqtt()) {
       Serial.println("[MQTT] Connessione fallita");
       Serial.println("[MQTT] Esecuzione test diagnostici...");
       
@@ -63,25 +85,36 @@ void setup() {
           Serial.println("[MQTT] Test TCP fallito");
       }
       
-      while (1);
+      // Il controllo accessi funziona anche senza broker: gli eventi
+      // restano in coda e la connessione viene ritentata dal loop
+      Serial.println("[MQTT] Funzionamento offline, nuovo tentativo in background");
+      scheduleMqttRetry();
+  } else {
+      Serial.println("[MQTT] Connessione stabilita");
   }
-  Serial.println("[MQTT] Connessione stabilita");
   
   // Inizializzazione componenti
   if (!nfcManager.begin()){
+      Log.flush();
       Serial.println("[INIT] Errore inizializzazione componenti nfcManager");
       while (1);
   }
 
-  mqttClient.onMessage(onMessageReceived);
-  mqttClient.subscribe("nfc/response");
-  mqttClient.subscribe("arduino/response");
-  Serial.println("[MQTT] Topic configurati");
-  
-  // Pre-registrazione tag
-  uint8_t preRegisteredTag[7] = {0x41, 0xCA, 0xDD, 0x00, 0x00, 0x00, 0x00}; 
-  if (!tagCache.addTag(preRegisteredTag))
-    Serial.println("[CACHE] Errore registrazione tag");
+#ifdef DOOR_LOCK_PIN
+  // Serratura aperta appena l'accesso è deciso, rilasciata da update()
+  nfcManager.attachLock(DOOR_LOCK_PIN, DOOR_LOCK_PULSE_MS);
+  nfcManager.doorLock().printStats(Serial);
+#endif
+
+  // Ripristino della cache dalla EEPROM (la decifratura prosegue nel loop)
+  tagStoreEnabled = tagStore.begin();
+  if (!tagStoreEnabled)
+    Serial.println("[STORE] Area EEPROM insufficiente, cache non persistente");
+  tagStore.printFootprint(Serial);
+
+  nfcManager.keystream().printStats(Serial);
+  nfcManager.eventQueue().printStats(Serial);
+  nfcManager.printReaderStats(Serial);
 }
 
 
@@ -89,24 +122,122 @@ void loop() {
     static bool firstRun = true;
     
     if (firstRun) {
+        Log.flush();
         Serial.println("\n[SYSTEM] In attesa di tag NFC...");
         firstRun = false;
     }
 
+    // Le risposte di verifica arrivano con poll() e sono associate per ID:
+    // nessuna attesa dopo un tap, le verifiche scadute le decide update()
     if (nfcManager.update()) {
-        // Aspetta un po' per assicurarci che tutti i messaggi MQTT siano arrivati
-        delay(1000);
-        
-        // Gestisci eventuali messaggi MQTT pendenti
-        mqttClient.poll();
-        
         // Ora mostra che siamo pronti per un nuovo tag
-        Serial.println("\n[SYSTEM] In attesa di tag NFC...");
+        LOG_INFO.println("\n[SYSTEM] In attesa di tag NFC...");
+    } else {
+        // Nessun tag: keystream per il prossimo messaggio, poi
+        // ripristino, salvataggio e compattazione della cache
+        nfcManager.idle();
+        tagStore.tick();
+        preRegisterTags();
+        maintainMqtt();
+        // I log delle letture raggiungono la seriale solo nei tempi morti
+        Log.drain(Serial);
     }
 
     mqttClient.poll();
 }
 
+/**
+ * @brief Registra i tag predefiniti una volta ripristinata la cache
+ * @details Prima della fine del ripristino gli UID salvati non sono ancora
+ *          nell'indice: addTag() li scriverebbe in un nuovo slot e ogni
+ *          avvio lascerebbe un duplicato nel log. Senza area EEPROM
+ *          (tagStore.begin() fallito) la cache è già pronta.
+ */
+void preRegisterTags() {
+  static bool done = false;
+  if (done || (tagStoreEnabled && !tagStore.isReady())) return;
+  done = true;
+
+  uint8_t preRegisteredTag[7] = {0x41, 0xCA, 0xDD, 0x00, 0x00, 0x00, 0x00};
+  if (!tagCache.addTag(preRegisteredTag)) {
+    LOG_ERROR.println("[CACHE] Errore registrazione tag");
+  }
+}
+
+/**
+ * @brief Connette al broker e sottoscrive i topic di risposta
+ * @return true se la connessione è riuscita
+ */
+bool connectMqtt() {
+  if (!mqttClient.connect(BROKER_ADDRESS, BROKER_PORT))
+    return false;
+  mqttClient.subscribe("nfc/response");
+  mqttClient.subscribe("arduino/response");
+  LOG_INFO.println("[MQTT] Topic configurati");
+  return true;
+}
+
+/**
+ * @brief Pianifica il prossimo tentativo di connessione
+ * @details Attesa esponenziale da MQTT_RETRY_MIN_MS a MQTT_RETRY_MAX_MS con
+ *          un quarto di variazione casuale: più dispositivi disconnessi
+ *          insieme non si ripresentano al broker nello stesso istante
+ */
+void scheduleMqttRetry() {
+  mqttRetryAt = millis() + mqttRetryDelay + random(mqttRetryDelay / 4 + 1);
+  mqttRetryDelay = min(mqttRetryDelay * 2, MQTT_RETRY_MAX_MS);
+}
+
+/**
+ * @brief true se un tag è nel campo o una decisione attende il server
+ * @details Un tentativo di connessione ferma il loop: in questi casi
+ *          ritardarlo è meglio che ritardare la porta
+ */
+bool accessInProgress() {
+  return nfcManager.presenceTracker().present(millis()) > 0 ||
+         nfcManager.verifications().inFlight() > 0;
+}
+
+/**
+ * @brief Ripristina WiFi e broker se la connessione è caduta
+ * @details Chiamata nei tempi morti del loop; tra un tentativo e l'altro
+ *          non blocca. Ogni tentativo dura al più WIFI_JOIN_TIMEOUT_MS
+ *          per WiFi.begin() e MQTT_CONNECT_TIMEOUT_MS per la connessione
+ *          al broker, e non parte con un tag nel campo o una verifica in
+ *          corso. L'accesso alla rete prosegue nel modulo WiFi: un nuovo
+ *          WiFi.begin() parte solo dopo WIFI_JOIN_RETRY_MS e la connessione
+ *          al broker attende che la rete sia disponibile.
+ */
+void maintainMqtt() {
+  if (mqttClient.connected()) {
+    mqttRetryDelay = MQTT_RETRY_MIN_MS;
+    return;
+  }
+  if ((long)(millis() - mqttRetryAt) < 0 || accessInProgress()) return;
+
+  if (WiFi.status() != WL_CONNECTED) {
+    if (!wifiJoining || millis() - wifiJoinAt >= WIFI_JOIN_RETRY_MS) {
+      LOG_WARN.println("[WIFI] Connessione persa, nuovo tentativo...");
+      WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+      wifiJoinAt = millis();
+      wifiJoining = true;
+    }
+    // Il broker si ritenta appena la rete torna, senza allungare l'attesa
+    mqttRetryAt = millis() + MQTT_RETRY_MIN_MS;
+    return;
+  }
+  wifiJoining = false;
+
+  LOG_WARN.println("[MQTT] Riconnessione al broker...");
+  if (connectMqtt()) {
+    LOG_INFO.println("[MQTT] Connessione ripristinata");
+    mqttRetryDelay = MQTT_RETRY_MIN_MS;
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) nfcManager.eventQueue().printStats(Log);
+  } else {
+    scheduleMqttRetry();
+  }
+}
+
 String getMacAddress() {
   byte mac[6];
   WiFi.macAddress(mac);
@@ -118,8 +249,11 @@ String getMacAddress() {
 
 void onMessageReceived(int messageSize) {
   String topic = mqttClient.messageTopic();
-  String payload = mqttClient.readString();
+  char payload[96];
+  int len = mqttClient.read((uint8_t*)payload, sizeof(payload) - 1);
+  payload[len > 0 ? len : 0] = '\0';
   
-  Serial.println("\n[MQTT] Messaggio ricevuto");
-  Serial.println(payload);
+  LOG_DEBUG.println("\n[MQTT] Messaggio ricevuto");
+  LOG_DEBUG.println(payload);
+  nfcManager.handleResponse(topic.c_str(), payload);
 }
\ No newline at end of file
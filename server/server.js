@@ -49,6 +49,47 @@ function TEA_decrypt_block_LE(block, key) {
    return result;
 }
 
+function TEA_encrypt_block_LE(block, key) {
+   let y = block.readUInt32LE(0);
+   let z = block.readUInt32LE(4);
+   const k0 = key.readUInt32LE(0);
+   const k1 = key.readUInt32LE(4);
+   const k2 = key.readUInt32LE(8);
+   const k3 = key.readUInt32LE(12);
+
+   const delta = 0x9E3779B9;
+   let sum = 0;
+
+   for (let i = 0; i < 32; i++) {
+       sum = (sum + delta) >>> 0;
+       y = (y + ((((z << 4) + k0) ^ (z + sum) ^ ((z >>> 5) + k1)) >>> 0)) >>> 0;
+       z = (z + ((((y << 4) + k2) ^ (y + sum) ^ ((y >>> 5) + k3)) >>> 0)) >>> 0;
+   }
+
+   const result = Buffer.alloc(8);
+   result.writeUInt32LE(y, 0);
+   result.writeUInt32LE(z, 4);
+   return result;
+}
+
+// Modalità CTR: blocco contatore = IV con la seconda parola incrementata per blocco
+function decryptCTR(data, iv) {
+   const key = Buffer.from(process.env.CRYPTO_KEY, 'hex');
+   const decrypted = Buffer.alloc(data.length);
+   const counter = Buffer.from(iv);
+   const n1 = iv.readUInt32LE(4);
+
+   for (let i = 0; i * 8 < data.length; i++) {
+       counter.writeUInt32LE((n1 + i) >>> 0, 4);
+       const stream = TEA_encrypt_block_LE(counter, key);
+       for (let j = 0; j < 8 && i * 8 + j < data.length; j++) {
+           decrypted[i * 8 + j] = data[i * 8 + j] ^ stream[j];
+       }
+   }
+
+   return decrypted;
+}
+
 function decrypt(data) {
    if (data.length % 8 !== 0) {
        throw new Error('La lunghezza dei dati deve essere multiplo di 8 byte');
@@ -113,25 +154,162 @@ function generateMAC(data) {
    return mac;
 }
 
-function decryptAndVerify(message) {
-   
+// SipHash-2-4 con chiave a 128 bit, parole da 64 bit little-endian
+const MASK64 = (1n << 64n) - 1n;
 
-   const iv = hexToBuffer(message.slice(0, 16));
-   const mac = hexToBuffer(message.slice(-16));
-   const ciphertext = hexToBuffer(message.slice(16, -16));
+function rotl64(x, b) {
+   return ((x << b) | (x >> (64n - b))) & MASK64;
+}
 
-   const dataForMac = Buffer.concat([iv, ciphertext]);
-   const calculatedMac = generateMAC(dataForMac);
+function sipRound(v) {
+   v[0] = (v[0] + v[1]) & MASK64; v[1] = rotl64(v[1], 13n); v[1] ^= v[0]; v[0] = rotl64(v[0], 32n);
+   v[2] = (v[2] + v[3]) & MASK64; v[3] = rotl64(v[3], 16n); v[3] ^= v[2];
+   v[0] = (v[0] + v[3]) & MASK64; v[3] = rotl64(v[3], 21n); v[3] ^= v[0];
+   v[2] = (v[2] + v[1]) & MASK64; v[1] = rotl64(v[1], 17n); v[1] ^= v[2]; v[2] = rotl64(v[2], 32n);
+}
+
+function sipHash24(key, data) {
+   const k0 = key.readBigUInt64LE(0);
+   const k1 = key.readBigUInt64LE(8);
+   const v = [
+       k0 ^ 0x736f6d6570736575n,
+       k1 ^ 0x646f72616e646f6dn,
+       k0 ^ 0x6c7967656e657261n,
+       k1 ^ 0x7465646279746573n
+   ];
+
+   const compress = (m) => {
+       v[3] ^= m;
+       sipRound(v);
+       sipRound(v);
+       v[0] ^= m;
+   };
+
+   const fullWords = data.length - (data.length % 8);
+   for (let i = 0; i < fullWords; i += 8) {
+       compress(data.readBigUInt64LE(i));
+   }
+
+   const last = Buffer.alloc(8);
+   data.copy(last, 0, fullWords);
+   last[7] = data.length & 0xFF;
+   compress(last.readBigUInt64LE(0));
+
+   v[2] ^= 0xFFn;
+   for (let i = 0; i < 4; i++) sipRound(v);
+
+   const mac = Buffer.alloc(8);
+   mac.writeBigUInt64LE(v[0] ^ v[1] ^ v[2] ^ v[3]);
+   return mac;
+}
+
+// Formato versionato: header || IV || ciphertext || MAC, header = modalità | (MAC << 4)
+const SECURE_MODE_ECB = 0x0;
+const SECURE_MODE_CTR = 0x1;
+const SECURE_MAC_LEGACY = 0x0;
+const SECURE_MAC_SIPHASH = 0x1;
+// Frame binario: versione || flags || IV || ciphertext || MAC, flags come l'header
+const SECURE_FRAME_VERSION = 0x02;
+// Frame con ID della richiesta: versione || flags || ID (2 byte LE) || IV || ciphertext || MAC
+const SECURE_FRAME_VERSION_ID = 0x03;
+
+// Separa il messaggio in prefisso autenticato, IV, ciphertext e MAC
+function parseSecureMessage(message) {
+   let raw;
+   let prefixLength;
+   let flagsOffset = 0;
+
+   // Il primo byte del frame binario non è mai una cifra esadecimale
+   const version = Buffer.isBuffer(message) && message.length > 0 ? message[0] : null;
+   if (version === SECURE_FRAME_VERSION || version === SECURE_FRAME_VERSION_ID) {
+       raw = message;
+       prefixLength = version === SECURE_FRAME_VERSION_ID ? 4 : 2;
+       flagsOffset = 1;
+   } else {
+       const text = message.toString();
+       raw = hexToBuffer(text);
+       if (raw.length * 2 !== text.length) {
+           throw new Error('Formato del messaggio non valido');
+       }
+       // Il formato precedente (senza header) ha sempre un numero pari di byte
+       prefixLength = raw.length % 2 === 1 ? 1 : 0;
+   }
+
+   if (raw.length < prefixLength + 16) {
+       throw new Error('Formato del messaggio non valido');
+   }
+
+   const prefix = raw.slice(0, prefixLength);
+   const flags = prefixLength > 0 ? prefix[flagsOffset] : 0;
+   const body = raw.slice(prefixLength);
+   return {
+       prefix,
+       requestId: prefixLength === 4 ? prefix.readUInt16LE(2) : null,
+       mode: flags & 0x0F,
+       macAlgorithm: flags >> 4,
+       iv: body.slice(0, 8),
+       ciphertext: body.slice(8, -8),
+       mac: body.slice(-8)
+   };
+}
+
+// Accetta il frame binario (Buffer) o il messaggio esadecimale (stringa o Buffer).
+// Restituisce il testo in chiaro e l'ID della richiesta (null se il messaggio non lo ha);
+// l'ID è restituito solo dopo la verifica del MAC, che lo copre
+function decryptAndVerifyRequest(message) {
+   const { prefix, requestId, mode, macAlgorithm, iv, ciphertext, mac } = parseSecureMessage(message);
+
+   if (mode !== SECURE_MODE_ECB && mode !== SECURE_MODE_CTR) {
+       throw new Error('Modalità di cifratura non supportata');
+   }
+   if (macAlgorithm !== SECURE_MAC_LEGACY && macAlgorithm !== SECURE_MAC_SIPHASH) {
+       throw new Error('Algoritmo di MAC non supportato');
+   }
+
+   const dataForMac = Buffer.concat([prefix, iv, ciphertext]);
+   const calculatedMac = macAlgorithm === SECURE_MAC_SIPHASH
+       ? sipHash24(Buffer.from(process.env.CRYPTO_KEY, 'hex'), dataForMac)
+       : generateMAC(dataForMac);
 
    if (!calculatedMac.equals(mac)) {
        console.log("[SECURITY] Verifica integrità fallita");
        throw new Error('MAC verification failed');
    }
 
-   const plaintext = decrypt(ciphertext);
+   const plaintext = mode === SECURE_MODE_CTR ? decryptCTR(ciphertext, iv) : decrypt(ciphertext);
    const trimmedPlaintext = removeZeroPadding(plaintext);
 
-   return trimmedPlaintext;
+   return { plaintext: trimmedPlaintext, requestId };
+}
+
+function decryptAndVerify(message) {
+   return decryptAndVerifyRequest(message).plaintext;
+}
+
+// Risposta su nfc/response: con un ID il dispositivo la associa alla richiesta in corso
+function responsePayload(text, requestId) {
+   return Buffer.from(requestId === null ? text : `${text} id=${requestId}`);
+}
+
+// Validità degli esiti firmati che il dispositivo può riusare senza chiedere (secondi)
+const VERDICT_GRANT_TTL = parseInt(process.env.VERDICT_GRANT_TTL || '300', 10);
+const VERDICT_DENY_TTL = parseInt(process.env.VERDICT_DENY_TTL || '60', 10);
+// Primo byte dei dati firmati: 'R' || esito || ID (2 LE) || ttl (4 LE) || UID (7, completato con zeri)
+const VERIFY_RESPONSE_TAG = 0x52;
+
+// Esito di nfc/verify con ID, validità e firma: il dispositivo lo memorizza per i tap successivi.
+// Senza ID (richieste esadecimali) la risposta resta quella precedente, senza firma
+function verdictPayload(text, requestId, uid, granted) {
+   if (requestId === null) return responsePayload(text, null);
+   const ttl = granted ? VERDICT_GRANT_TTL : VERDICT_DENY_TTL;
+   const data = Buffer.alloc(15);
+   data[0] = VERIFY_RESPONSE_TAG;
+   data[1] = granted ? 1 : 0;
+   data.writeUInt16LE(requestId, 2);
+   data.writeUInt32LE(ttl, 4);
+   uid.copy(data, 8, 0, Math.min(uid.length, 7));
+   const sig = sipHash24(Buffer.from(process.env.CRYPTO_KEY, 'hex'), data).toString('hex');
+   return Buffer.from(`${text} id=${requestId} ttl=${ttl} sig=${sig}`);
 }
 
 function hashValue(value) {
@@ -229,6 +407,17 @@ db.serialize(() => {
        uid TEXT NOT NULL
     )`);
 
+    db.run(`CREATE TABLE IF NOT EXISTS metrics (
+       id INTEGER PRIMARY KEY AUTOINCREMENT,
+       device TEXT,
+       stage TEXT NOT NULL,
+       samples INTEGER NOT NULL,
+       p50_us INTEGER,
+       p99_us INTEGER,
+       max_us INTEGER,
+       timestamp TEXT NOT NULL
+    )`);
+
     db.run(`CREATE TABLE IF NOT EXISTS logs (
        id INTEGER PRIMARY KEY AUTOINCREMENT,
        username TEXT NOT NULL,
@@ -285,6 +474,61 @@ function addLogEntry(logEntry) {
     });
 }
 
+// Transazioni dei blocchi una dopo l'altra: COMMIT e ROLLBACK arrivano dalle callback
+let logBatchQueue = Promise.resolve();
+
+// Inserisce più righe di log in una sola transazione (blocchi su nfc/batch)
+function addLogEntries(entries, callback) {
+    logBatchQueue = logBatchQueue.then(() => new Promise(resolve => {
+        insertLogBatch(entries, (error) => {
+            resolve();
+            if (callback) callback(error);
+        });
+    }));
+}
+
+function insertLogBatch(entries, callback) {
+    db.serialize(() => {
+        db.run('BEGIN TRANSACTION');
+        const stmt = db.prepare(`INSERT INTO logs (username, password, auth_state, topic, uid_tag, tag_state, timestamp, error) VALUES (?, ?, ?, ?, ?, ?, ?, ?)`);
+        let failed = null;
+        entries.forEach(entry => {
+            stmt.run(
+                entry.username,
+                entry.password,
+                entry.auth_state,
+                entry.topic,
+                entry.uid_tag,
+                entry.tag_state,
+                entry.timestamp,
+                entry.error,
+                function (err) {
+                    if (err && !failed) failed = err;
+                }
+            );
+        });
+        // Il blocco viene registrato per intero o per niente
+        stmt.finalize(() => {
+            const done = (error) => {
+                if (error) {
+                    console.error("Errore nell'inserimento dei log:", error);
+                } else {
+                    console.log(`Log inseriti: ${entries.length}`);
+                }
+                callback(error);
+            };
+            if (failed) {
+                db.run('ROLLBACK', () => done(failed));
+            } else {
+                db.run('COMMIT', (err) => {
+                    if (err) db.run('ROLLBACK', () => done(err));
+                    else done(null);
+                });
+            }
+        });
+    });
+}
+
 // ---------------------------------------------------------------------
 // VERIFICA UID
 // ---------------------------------------------------------------------
@@ -307,19 +551,128 @@ function verifyUIDInDB(uid) {
    });
 }
 
+// ---------------------------------------------------------------------
+// EVENTI OFFLINE
+// ---------------------------------------------------------------------
+
+// Record di nfc/batch: tipo || lunghezza UID || UID (7) || età in secondi (4 LE)
+const EVENT_RECORD_LEN = 13;
+const EVENT_TIME_UNKNOWN = 0xFFFFFFFF;
+const EVENT_TYPES = {
+    1: { topic: 'nfc/access', granted: true },            // Accesso concesso dalla cache
+    2: { topic: 'nfc/verify (offline)', granted: true },  // Politica locale: concesso
+    3: { topic: 'nfc/verify (offline)', granted: false }, // Politica locale: negato
+    4: { topic: 'nfc/verify (cache)', granted: true },    // Esito firmato memorizzato: concesso
+    5: { topic: 'nfc/verify (cache)', granted: false }    // Esito firmato memorizzato: negato
+};
+
+// Decodifica un blocco di eventi accodati dal dispositivo mentre il broker non era raggiungibile
+function parseEventBatch(plaintext) {
+    if (plaintext.length === 0) {
+        throw new Error('Blocco di eventi vuoto');
+    }
+    const count = plaintext[0];
+    const expectedLength = 1 + count * EVENT_RECORD_LEN;
+    if (plaintext.length > expectedLength) {
+        throw new Error('Blocco di eventi non valido');
+    }
+    // Gli zeri finali (età 0) sono stati rimossi insieme al padding
+    const data = Buffer.alloc(expectedLength);
+    plaintext.copy(data);
+
+    const now = Date.now();
+    const events = [];
+    for (let i = 0; i < count; i++) {
+        const record = data.slice(1 + i * EVENT_RECORD_LEN, 1 + (i + 1) * EVENT_RECORD_LEN);
+        const type = EVENT_TYPES[record[0]];
+        const uidLength = Math.min(record[1], 7);
+        const age = record.readUInt32LE(9);
+        if (!type) continue;  // Record perso sul dispositivo
+        events.push({
+            topic: type.topic,
+            granted: type.granted,
+            uid: record.slice(2, 2 + uidLength),
+            timestamp: age === EVENT_TIME_UNKNOWN ? null : new Date(now - age * 1000).toISOString()
+        });
+    }
+    return events;
+}
+
+// ---------------------------------------------------------------------
+// METRICHE DI LATENZA
+// ---------------------------------------------------------------------
+
+// nfc/metrics: versione || fase || primo intervallo || intervalli || max µs (4 LE) || conteggi (2 LE)
+// L'intervallo i conta le durate in [2^i, 2^(i+1)) µs
+const TAP_METRICS_VERSION = 1;
+const TAP_METRICS_BUCKETS = 24;
+const TAP_STAGES = ['read', 'cache', 'seal', 'publish', 'decision', 'server'];
+
+// Istogrammi sommati su tutti i dispositivi dall'avvio del server
+const fleetMetrics = TAP_STAGES.map(() => ({ buckets: new Array(TAP_METRICS_BUCKETS).fill(0), max: 0 }));
+
+function parseTapMetrics(plaintext) {
+    // Gli zeri finali (conteggi vuoti) sono stati rimossi insieme al padding
+    const data = Buffer.alloc(Math.max(plaintext.length, 8));
+    plaintext.copy(data);
+    if (data[0] !== TAP_METRICS_VERSION || data[1] >= TAP_STAGES.length ||
+        data[2] + data[3] > TAP_METRICS_BUCKETS || data[3] === 0 || plaintext.length > 8 + 2 * data[3]) {
+        throw new Error('Metriche non valide');
+    }
+    const counts = Buffer.alloc(2 * data[3]);
+    data.copy(counts, 0, 8);
+
+    const buckets = new Array(TAP_METRICS_BUCKETS).fill(0);
+    for (let i = 0; i < data[3]; i++) {
+        buckets[data[2] + i] = counts.readUInt16LE(2 * i);
+    }
+    return { stage: data[1], buckets, max: data.readUInt32LE(4) };
+}
+
+// Limite superiore dell'intervallo che contiene il percentile (µs)
+function histogramPercentile(buckets, percent) {
+    const total = buckets.reduce((a, b) => a + b, 0);
+    if (total === 0) return null;
+    const rank = Math.ceil(total * percent / 100);
+    let seen = 0;
+    for (let i = 0; i < buckets.length; i++) {
+        seen += buckets[i];
+        if (seen >= rank) return 2 ** (i + 1);
+    }
+    return 2 ** buckets.length;
+}
+
+function recordTapMetrics(device, metrics) {
+    const stage = TAP_STAGES[metrics.stage];
+    const samples = metrics.buckets.reduce((a, b) => a + b, 0);
+    const p50 = histogramPercentile(metrics.buckets, 50);
+    const p99 = histogramPercentile(metrics.buckets, 99);
+
+    const fleet = fleetMetrics[metrics.stage];
+    metrics.buckets.forEach((count, i) => { fleet.buckets[i] += count; });
+    fleet.max = Math.max(fleet.max, metrics.max);
+
+    console.log(`[METRICS] ${stage}: ${samples} campioni, p50 < ${p50} us, p99 < ${p99} us, max ${metrics.max} us ` +
+                `(flotta: p50 < ${histogramPercentile(fleet.buckets, 50)} us, p99 < ${histogramPercentile(fleet.buckets, 99)} us)`);
+
+    db.run(`INSERT INTO metrics (device, stage, samples, p50_us, p99_us, max_us, timestamp) VALUES (?, ?, ?, ?, ?, ?, ?)`,
+        [device, stage, samples, p50, p99, metrics.max, new Date().toISOString()],
+        (err) => { if (err) console.error("[DB] Errore nell'inserimento delle metriche:", err); });
+}
+
 // ---------------------------------------------------------------------
 // GESTIONE MESSAGGI MQTT
 // ---------------------------------------------------------------------
 
 aedes.on('publish', (packet, client) => {
    if (!client) return;
-   const payloadStr = packet.payload.toString();
 
    try {
        if (packet.topic === 'nfc/verify' || packet.topic === 'nfc/access') {
            console.log(`\n[MQTT] Messaggio ricevuto su "${packet.topic}"`);
 
-           const uid = decryptAndVerify(payloadStr);
+           // Frame binario o esadecimale: il Buffer viene passato senza conversioni
+           const { plaintext: uid, requestId } = decryptAndVerifyRequest(packet.payload);
            logEntry.uid_tag = uid;
 
            if (packet.topic === 'nfc/verify') {
@@ -331,14 +684,14 @@ aedes.on('publish', (packet, client) => {
                            console.log("[ACCESS] Verifica UID completata con successo");
                            aedes.publish({
                                topic: 'nfc/response',
-                               payload: Buffer.from("[RESULT] ACCESS GRANTED")
+                               payload: verdictPayload("[RESULT] ACCESS GRANTED", requestId, uid, true)
                            });
                        } else {
                            logEntry.tag_state = false;
                            console.log("[ACCESS] Verifica UID fallita");
                            aedes.publish({
                                topic: 'nfc/response',
-                               payload: Buffer.from("[RESULT] ACCESS DENIED")
+                               payload: verdictPayload("[RESULT] ACCESS DENIED", requestId, uid, false)
                            });
                        }
                    })
@@ -349,7 +702,7 @@ aedes.on('publish', (packet, client) => {
                        console.error("[ERROR] Errore durante la verifica");
                        aedes.publish({
                            topic: 'nfc/response',
-                           payload: Buffer.from("[ERROR] Errore nella verifica del tag")
+                           payload: responsePayload("[ERROR] Errore nella verifica del tag", requestId)
                        });
                    });
                logEntry.error = null;
@@ -367,6 +720,37 @@ aedes.on('publish', (packet, client) => {
                logEntry.error = null;
                logEntry.timestamp = new Date().toISOString();
            }
+       }
+       else if (packet.topic === 'nfc/batch') {
+           console.log(`\n[MQTT] Messaggio ricevuto su "${packet.topic}"`);
+
+           // Accessi raggruppati o eventi offline: una transazione e una risposta per blocco
+           const events = parseEventBatch(decryptAndVerify(packet.payload));
+           const entries = events.map(event => ({
+               ...logEntry,
+               topic: event.topic,
+               uid_tag: event.uid,
+               tag_state: event.granted,
+               // Istante non noto se l'evento precede un riavvio del dispositivo
+               timestamp: event.timestamp || new Date().toISOString(),
+               error: event.timestamp ? null : '[QUEUE] Istante dell\'evento sconosciuto'
+           }));
+           addLogEntries(entries, (err) => {
+               console.log(`[ACCESS] Blocco di ${events.length} eventi ${err ? 'non registrato' : 'registrato'}`);
+               aedes.publish({
+                   topic: 'nfc/response',
+                   payload: Buffer.from(err
+                       ? "[ERROR] Errore nella registrazione del blocco di eventi"
+                       : `[LOG] ${events.length} eventi registrati nei log del server`)
+               });
+           });
+           // Le righe del blocco sostituiscono la riga del messaggio
+           return;
+       }
+       else if (packet.topic === 'nfc/metrics') {
+           // Istogrammi di latenza: tabella metrics, nessuna riga di log
+           recordTapMetrics(client.id, parseTapMetrics(decryptAndVerify(packet.payload)));
+           return;
        }else{
            logEntry.topic = null;
            logEntry.uid_tag = null;
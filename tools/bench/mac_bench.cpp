@@ -0,0 +1,142 @@
+/**
+ * Benchmark host del MAC di LightweightCrypto.
+ *
+ * Confronta l'hash originale (un round ARX per byte) con SipHash-2-4
+ * (una compressione ogni 8 byte) sulle lunghezze dei messaggi del sistema.
+ * Verifica SipHash con i vettori di riferimento e controlla che il MAC
+ * incrementale coincida con generateMAC() per qualsiasi suddivisione dei dati.
+ *
+ * Compilazione ed esecuzione (dalla root del repository):
+ *   g++ -O2 -std=c++17 -I arduino/sketch_jan25b tools/bench/mac_bench.cpp \
+ *       arduino/sketch_jan25b/LightweightCrypto.cpp arduino/sketch_jan25b/TeaBatch.cpp \
+ *       -o mac_bench && ./mac_bench
+ *
+ * I valori sono in cicli per messaggio (rdtsc su x86, altrimenti nanosecondi).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cicli"
+static inline uint64_t now() { return __rdtsc(); }
+#else
+#define BENCH_UNIT "ns"
+static inline uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#include "LightweightCrypto.h"
+
+static const int ITERATIONS = 20000;
+
+// Vettori di riferimento SipHash-2-4: chiave 00..0f, messaggio 00..(n-1)
+struct SipVector {
+    size_t len;
+    uint8_t mac[8];
+};
+
+static const SipVector SIP_VECTORS[] = {
+    { 0,  { 0x31, 0x0e, 0x0e, 0xdd, 0x47, 0xdb, 0x6f, 0x72 } },
+    { 15, { 0xe5, 0x45, 0xbe, 0x49, 0x61, 0xca, 0x29, 0xa1 } },
+    { 63, { 0x72, 0x45, 0x06, 0xeb, 0x4c, 0x32, 0x8a, 0x95 } }
+};
+
+static bool checkVectors() {
+    uint8_t key[16], data[64], mac[8];
+    for (uint8_t i = 0; i < 16; i++) key[i] = i;
+    for (uint8_t i = 0; i < 64; i++) data[i] = i;
+
+    LightweightCrypto crypto;
+    crypto.setKey(key, 16);
+    crypto.setMacAlgorithm(SECURE_MAC_SIPHASH);
+
+    bool ok = true;
+    for (const SipVector& v : SIP_VECTORS) {
+        crypto.generateMAC(data, v.len, mac);
+        ok &= memcmp(mac, v.mac, 8) == 0;
+    }
+    return ok;
+}
+
+// Il MAC incrementale a pezzi casuali deve coincidere con quello in un'unica chiamata
+static bool checkStreaming(uint8_t algorithm) {
+    uint8_t key[16], data[200], expected[8], mac[8];
+    for (uint8_t i = 0; i < 16; i++) key[i] = (uint8_t)(i * 7 + 1);
+    for (uint8_t i = 0; i < 200; i++) data[i] = (uint8_t)(i * 13 + 5);
+
+    LightweightCrypto crypto;
+    crypto.setKey(key, 16);
+    crypto.setMacAlgorithm(algorithm);
+
+    srand(1);
+    for (int trial = 0; trial < 2000; trial++) {
+        size_t len = rand() % sizeof(data);
+        crypto.generateMAC(data, len, expected);
+
+        MacState state;
+        crypto.macInit(state);
+        for (size_t done = 0; done < len;) {
+            size_t n = 1 + rand() % 11;
+            if (n > len - done) n = len - done;
+            crypto.macUpdate(state, data + done, n);
+            done += n;
+        }
+        crypto.macFinal(state, mac);
+        if (memcmp(mac, expected, 8) != 0) return false;
+    }
+    return true;
+}
+
+static double measure(LightweightCrypto& crypto, const uint8_t* data, size_t len) {
+    uint8_t mac[8];
+    double best = 1e30;
+    for (int r = 0; r < 20; r++) {
+        uint64_t start = now();
+        for (int i = 0; i < ITERATIONS; i++) {
+            crypto.generateMAC(data, len, mac);
+            __asm__ __volatile__("" : : "r"(mac) : "memory");
+        }
+        double perMessage = (double)(now() - start) / ITERATIONS;
+        if (perMessage < best) best = perMessage;
+    }
+    return best;
+}
+
+int main() {
+    bool vectors = checkVectors();
+    bool legacyStream = checkStreaming(SECURE_MAC_LEGACY);
+    bool sipStream = checkStreaming(SECURE_MAC_SIPHASH);
+    printf("Vettori SipHash-2-4: %s, incrementale originale: %s, incrementale SipHash: %s\n\n",
+           vectors ? "ok" : "ERRORE", legacyStream ? "ok" : "ERRORE", sipStream ? "ok" : "ERRORE");
+
+    static const uint8_t KEY[16] = {
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF
+    };
+    LightweightCrypto legacy, sip;
+    legacy.setKey(KEY, 16);
+    sip.setKey(KEY, 16);
+    sip.setMacAlgorithm(SECURE_MAC_SIPHASH);
+
+    // header || IV || ciphertext: UID (8 byte), MAC del dispositivo (24), API key (32)
+    static const size_t LENGTHS[] = { 17, 33, 41, 57 };
+    uint8_t data[64];
+    for (uint8_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 31 + 11);
+
+    printf("%-10s %14s %14s %10s\n", "Byte", "originale", "SipHash-2-4", "rapporto");
+    for (size_t len : LENGTHS) {
+        double a = measure(legacy, data, len);
+        double b = measure(sip, data, len);
+        printf("%-10zu %14.1f %14.1f %9.1fx\n", len, a, b, a / b);
+    }
+    printf("(%s per messaggio)\n", BENCH_UNIT);
+
+    return (vectors && legacyStream && sipStream) ? 0 : 1;
+}
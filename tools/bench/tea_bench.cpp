@@ -0,0 +1,198 @@
+/**
+ * Benchmark host del cifrario TEA usato da LightweightCrypto.
+ *
+ * Confronta l'implementazione originale (chiave copiata a ogni blocco,
+ * ciclo da 32 round) con TeaCore (chiave scompattata in setKey, round
+ * srotolati o in ciclo) e con XteaCore (key schedule precalcolato).
+ * Misura poi i lotti di TeaBatch (scalare interlacciato, SSE2, AVX2), con
+ * chiave condivisa e con una chiave per blocco.
+ * Verifica che ogni implementazione produca gli stessi blocchi dell'originale.
+ *
+ * Compilazione ed esecuzione (dalla root del repository):
+ *   g++ -O2 -std=c++17 -I arduino/sketch_jan25b tools/bench/tea_bench.cpp \
+ *       arduino/sketch_jan25b/LightweightCrypto.cpp arduino/sketch_jan25b/TeaBatch.cpp \
+ *       -o tea_bench && ./tea_bench
+ *
+ * I valori sono in cicli per blocco da 8 byte (rdtsc su x86, altrimenti
+ * nanosecondi per blocco).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cicli"
+static inline uint64_t now() { return __rdtsc(); }
+#else
+#define BENCH_UNIT "ns"
+static inline uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#include "LightweightCrypto.h"
+
+static const uint8_t KEY[16] = {
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF
+};
+
+static const size_t BLOCKS = 4096;
+static const int REPEAT = 200;
+
+// Implementazione originale di LightweightCrypto::TEA_encrypt_block
+__attribute__((noinline))
+static void legacyEncryptBlock(uint8_t* block, const uint8_t keyBytes[16]) {
+    uint32_t v0, v1;
+    memcpy(&v0, block, 4);
+    memcpy(&v1, block + 4, 4);
+
+    uint32_t keyParts[4];
+    memcpy(keyParts, keyBytes, 16);
+
+    uint32_t sum = 0;
+    uint32_t delta = 0x9E3779B9;
+    for (int i = 0; i < 32; i++) {
+        sum += delta;
+        v0 += ((v1 << 4) + keyParts[0]) ^ (v1 + sum) ^ ((v1 >> 5) + keyParts[1]);
+        v1 += ((v0 << 4) + keyParts[2]) ^ (v0 + sum) ^ ((v0 >> 5) + keyParts[3]);
+    }
+
+    memcpy(block, &v0, 4);
+    memcpy(block + 4, &v1, 4);
+}
+
+static uint8_t buffer[BLOCKS * 8];
+static uint8_t keys[BLOCKS * 16];
+
+static TeaCore<32, true> unrolled;
+static TeaCore<32, false> loop;
+static XteaCore<32> xtea;
+
+// Un blocco per chiamata, come sul microcontrollore: impedisce al compilatore
+// host di vettorizzare più blocchi insieme, cosa che il Cortex-M4 non può fare
+__attribute__((noinline)) static void unrolledEncrypt(uint8_t* b) { unrolled.encryptBlock(b); }
+__attribute__((noinline)) static void unrolledDecrypt(uint8_t* b) { unrolled.decryptBlock(b); }
+__attribute__((noinline)) static void loopEncrypt(uint8_t* b) { loop.encryptBlock(b); }
+__attribute__((noinline)) static void xteaEncrypt(uint8_t* b) { xtea.encryptBlock(b); }
+
+static void fill() {
+    for (size_t i = 0; i < sizeof(buffer); i++) buffer[i] = (uint8_t)(i * 131 + 7);
+}
+
+template <typename F>
+static double measure(F run) {
+    double best = 1e30;
+    for (int r = 0; r < REPEAT; r++) {
+        uint64_t start = now();
+        run();
+        double perBlock = (double)(now() - start) / BLOCKS;
+        if (perBlock < best) best = perBlock;
+    }
+    return best;
+}
+
+int main() {
+    static uint8_t expected[BLOCKS * 8];
+    fill();
+    for (size_t i = 0; i < BLOCKS; i++) legacyEncryptBlock(buffer + i * 8, KEY);
+    memcpy(expected, buffer, sizeof(buffer));
+
+    LightweightCrypto crypto;
+    unrolled.setKey(KEY);
+    loop.setKey(KEY);
+    xtea.setKey(KEY);
+    crypto.setKey(KEY, sizeof(KEY));
+
+    fill();
+    for (size_t i = 0; i < BLOCKS; i++) unrolled.encryptBlock(buffer + i * 8);
+    bool sameUnrolled = memcmp(buffer, expected, sizeof(buffer)) == 0;
+    for (size_t i = 0; i < BLOCKS; i++) unrolled.decryptBlock(buffer + i * 8);
+    fill();
+    crypto.encrypt(buffer, sizeof(buffer));
+    bool sameCrypto = memcmp(buffer, expected, sizeof(buffer)) == 0;
+    crypto.decrypt(buffer, sizeof(buffer));
+    bool roundTrip = buffer[8] == (uint8_t)(8 * 131 + 7);
+    fill();
+    for (size_t i = 0; i < BLOCKS; i++) loop.encryptBlock(buffer + i * 8);
+    bool sameLoop = memcmp(buffer, expected, sizeof(buffer)) == 0;
+
+    printf("Corrispondenza con l'originale: srotolato %s, ciclo %s, LightweightCrypto %s, decifratura %s\n",
+           sameUnrolled ? "ok" : "ERRORE", sameLoop ? "ok" : "ERRORE",
+           sameCrypto ? "ok" : "ERRORE", roundTrip ? "ok" : "ERRORE");
+
+    double legacy = measure([] {
+        for (size_t i = 0; i < BLOCKS; i++) legacyEncryptBlock(buffer + i * 8, KEY);
+    });
+    double fast = measure([] {
+        for (size_t i = 0; i < BLOCKS; i++) unrolledEncrypt(buffer + i * 8);
+    });
+    double fastDec = measure([] {
+        for (size_t i = 0; i < BLOCKS; i++) unrolledDecrypt(buffer + i * 8);
+    });
+    double looping = measure([] {
+        for (size_t i = 0; i < BLOCKS; i++) loopEncrypt(buffer + i * 8);
+    });
+    double viaCrypto = measure([&] { crypto.encrypt(buffer, sizeof(buffer)); });
+    double x = measure([] {
+        for (size_t i = 0; i < BLOCKS; i++) xteaEncrypt(buffer + i * 8);
+    });
+
+    printf("%-34s %8s/blocco\n", "Implementazione", BENCH_UNIT);
+    printf("%-34s %8.1f\n", "TEA originale", legacy);
+    printf("%-34s %8.1f\n", "TeaCore<32> ciclo", looping);
+    printf("%-34s %8.1f\n", "TeaCore<32> srotolato", fast);
+    printf("%-34s %8.1f\n", "TeaCore<32> srotolato (decifra)", fastDec);
+    printf("%-34s %8.1f\n", "LightweightCrypto::encrypt", viaCrypto);
+    printf("%-34s %8.1f\n", "XteaCore<32> srotolato", x);
+
+    // Lotti: riferimento per blocco con chiavi diverse, poi ogni percorso
+    static uint8_t perKey[BLOCKS * 8];
+    for (size_t i = 0; i < sizeof(keys); i++) keys[i] = (uint8_t)(i * 29 + 3);
+    fill();
+    for (size_t i = 0; i < BLOCKS; i++) legacyEncryptBlock(buffer + i * 8, keys + i * 16);
+    memcpy(perKey, buffer, sizeof(buffer));
+
+    static const TeaBatchPath paths[] = { TEA_BATCH_SCALAR, TEA_BATCH_SSE2, TEA_BATCH_AVX2 };
+    static const char* names[] = { "scalare", "SSE2", "AVX2" };
+    static const size_t counts[] = { BLOCKS, BLOCKS - 1, 13, 7, 3, 1 };
+    bool batchOk = true;
+
+    printf("\n%-34s %8s %12s\n", "Lotto", "stato", "cicli/blocco");
+    for (uint8_t p = 0; p < 3; p++) {
+        if (!teaBatchSupported(paths[p])) {
+            printf("%-34s %8s\n", names[p], "assente");
+            continue;
+        }
+        bool ok = true;
+        for (uint8_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            size_t n = counts[c];
+            fill();
+            teaBatchEncrypt(buffer, n, KEY, 0, 32, paths[p]);
+            ok &= memcmp(buffer, expected, n * 8) == 0;
+            teaBatchDecrypt(buffer, n, KEY, 0, 32, paths[p]);
+            ok &= buffer[n * 8 - 1] == (uint8_t)((n * 8 - 1) * 131 + 7);
+            fill();
+            teaBatchEncrypt(buffer, n, keys, 16, 32, paths[p]);
+            ok &= memcmp(buffer, perKey, n * 8) == 0;
+            teaBatchDecrypt(buffer, n, keys, 16, 32, paths[p]);
+            ok &= buffer[n * 8 - 1] == (uint8_t)((n * 8 - 1) * 131 + 7);
+        }
+        batchOk &= ok;
+
+        TeaBatchPath path = paths[p];
+        double shared = measure([path] { teaBatchEncrypt(buffer, BLOCKS, KEY, 0, 32, path); });
+        double each = measure([path] { teaBatchEncrypt(buffer, BLOCKS, keys, 16, 32, path); });
+        printf("%-34s %8s %12.1f\n", names[p], ok ? "ok" : "ERRORE", shared);
+        printf("%-34s %8s %12.1f\n", (std::string(names[p]) + ", chiave per blocco").c_str(), "", each);
+    }
+    double best = measure([&] { crypto.encryptBlocks(buffer, BLOCKS); });
+    printf("%-34s %8s %12.1f\n", "LightweightCrypto::encryptBlocks", "", best);
+
+    return (sameUnrolled && sameLoop && sameCrypto && roundTrip && batchOk) ? 0 : 1;
+}